@@ -28,6 +28,7 @@
 #include "serialization.hpp"
 #include <algorithm>
 #include <stdexcept>
+#include <vtil/symex>
 
 #pragma warning(disable:4267)
 namespace vtil
@@ -41,8 +42,77 @@ namespace vtil
 		uint16_t magic_2 = 0xDEAD;
 	};
 	static_assert( sizeof( file_header ) == 8, "Invalid file header size." );
+
+	struct simplifier_cache_header
+	{
+		uint32_t magic_1 = 'CXSV';
+		uint16_t version = 2;
+		uint16_t magic_2 = 0xDEAD;
+		uint64_t directive_hash = 0;
+	};
+	static_assert( sizeof( simplifier_cache_header ) == 16, "Invalid cache header size." );
+
+	struct expression_dag_header
+	{
+		uint32_t magic_1 = 'DXSV';
+		uint16_t version = 1;
+		uint16_t magic_2 = 0xDEAD;
+	};
+	static_assert( sizeof( expression_dag_header ) == 8, "Invalid expression graph header size." );
 #pragma pack(pop)
 
+	// Tags used to describe the type of the symbolic entities serialized.
+	//
+	enum class identifier_tag : uint8_t
+	{
+		string,
+		variable
+	};
+	enum class iterator_tag : uint8_t
+	{
+		none,
+		free_form,
+		bound
+	};
+	enum class dag_record_tag : uint8_t
+	{
+		constant,
+		variable,
+		operation,
+		root,
+		reset
+	};
+
+	// Serialization of unsigned integers in LEB128, 7 bits per byte with the highest bit 
+	// indicating whether or not more bytes follow.
+	//
+	static void serialize_varint( std::ostream& out, uint64_t v )
+	{
+		char buffer[ 10 ];
+		size_t n = 0;
+		do
+		{
+			uint8_t byte = v & 0x7F;
+			v >>= 7;
+			buffer[ n++ ] = ( char ) ( byte | ( v ? 0x80 : 0 ) );
+		}
+		while ( v );
+		out.write( buffer, n );
+	}
+	static uint64_t deserialize_varint( std::istream& in )
+	{
+		uint64_t v = 0;
+		for ( bitcnt_t shift = 0; shift < 64; shift += 7 )
+		{
+			uint8_t byte;
+			deserialize( in, byte );
+			v |= uint64_t( byte & 0x7F ) << shift;
+			if ( !( byte & 0x80 ) )
+				return v;
+		}
+		throw std::runtime_error( "Resolved invalid varint." );
+	}
+
 	// Serialization of VTIL calling conventions.
 	//
 	void serialize( std::ostream& out, const call_convention& in )
@@ -329,5 +399,389 @@ namespace vtil
 			throw std::runtime_error( "Resolved invalid operand." );
 		}
 	}
+
+	// Checks whether the expression refers to a block that does not belong to the routine.
+	//
+	static bool refers_to_foreign_block( const symbolic::expression& exp, const routine* rtn )
+	{
+		bool result = false;
+		exp.enumerate( [ & ] ( const symbolic::expression& sub )
+		{
+			if ( result || !sub.is_variable() || !sub.uid.is<symbolic::variable>() )
+				return;
+
+			auto& var = sub.uid.get<symbolic::variable>();
+			if ( var.at.is_valid() && !var.is_free_form() && var.at.block->owner != rtn )
+				result = true;
+			else if ( var.is_memory() )
+				result = refers_to_foreign_block( *var.mem().decay(), rtn );
+		} );
+		return result;
+	}
+
+	// Serialization of the simplifier cache.
+	//
+	size_t save_simplifier_cache( std::ostream& out, const routine* rtn )
+	{
+		// Write the file header.
+		//
+		serialize( out, simplifier_cache_header{ .directive_hash = symbolic::get_directive_table_hash().as64() } );
+
+		// Serialize each entry into a length prefixed buffer, so that entries failing
+		// mid-way can be skipped both here and while loading.
+		//
+		std::vector<std::string> entries;
+		symbolic::enum_shared_simplifier_cache( [ & ] ( const symbolic::expression::reference& exp, const symbolic::expression::reference& result, bool is_simplified )
+		{
+			// Result is not necessarily set if the simplification failed.
+			//
+			if ( refers_to_foreign_block( *exp, rtn ) || ( result && refers_to_foreign_block( *result, rtn ) ) )
+				return;
+
+			std::stringstream ss;
+			try
+			{
+				serialize( ss, is_simplified );
+				serialize( ss, result.is_valid() );
+				expression_dag_writer writer{ ss, false };
+				writer.write( exp );
+				if ( result ) writer.write( result );
+			}
+			catch ( const std::runtime_error& )
+			{
+				return;
+			}
+			entries.emplace_back( ss.str() );
+		} );
+		serialize( out, entries );
+		return entries.size();
+	}
+	size_t load_simplifier_cache( std::istream& in, const routine* rtn )
+	{
+		// Read and validate the file header, reject the cache if it is stale.
+		//
+		simplifier_cache_header hdr;
+		deserialize( in, hdr );
+		if ( hdr.magic_1 != simplifier_cache_header{}.magic_1 ||
+			 hdr.magic_2 != simplifier_cache_header{}.magic_2 )
+			throw std::runtime_error( "Invalid simplifier cache header." );
+		if ( hdr.version != simplifier_cache_header{}.version || 
+			 hdr.directive_hash != symbolic::get_directive_table_hash().as64() )
+			return 0;
+
+		// Read each entry and insert into the shared cache, skipping the ones we cannot resolve.
+		//
+		clength_t count;
+		deserialize( in, count );
+
+		size_t n = 0;
+		std::string entry;
+		while ( count-- > 0 )
+		{
+			deserialize( in, entry );
+			std::istringstream ss{ entry };
+
+			symbolic::expression::reference exp, result;
+			bool is_simplified, has_result;
+			try
+			{
+				deserialize( ss, is_simplified );
+				deserialize( ss, has_result );
+				expression_dag_reader reader{ ss, rtn, false };
+				if ( !reader.read( exp ) || ( has_result && !reader.read( result ) ) )
+					throw std::out_of_range( "Reading past file end." );
+			}
+			catch ( const std::exception& )
+			{
+				continue;
+			}
+			symbolic::insert_shared_simplifier_cache( exp, result, is_simplified );
+			n++;
+		}
+		return n;
+	}
+	// Streaming serialization of symbolic expression graphs.
+	//
+	expression_dag_writer::expression_dag_writer( std::ostream& out, bool header ) : out( out )
+	{
+		if ( header )
+			serialize( out, expression_dag_header{} );
+	}
+	void expression_dag_writer::write( const symbolic::expression::reference& exp )
+	{
+		// Write the nodes that were not written before and then the root record referring to it.
+		//
+		uint64_t index = write_node( exp );
+		serialize( out, dag_record_tag::root );
+		serialize_varint( out, node_count - 1 - index );
+	}
+	void expression_dag_writer::reset()
+	{
+		nodes.clear();
+		node_count = 0;
+		serialize( out, dag_record_tag::reset );
+	}
+	uint64_t expression_dag_writer::write_node( const symbolic::expression::reference& exp )
+	{
+		// If an identical node was written before, refer to it.
+		//
+		if ( auto it = nodes.find( exp ); it != nodes.end() )
+			return it->second;
+
+		// Write the operands before the node itself, operations refer to them by the distance 
+		// from the node being written so that the indices stay small.
+		//
+		if ( exp->is_expression() )
+		{
+			std::optional<uint64_t> lhs;
+			if ( exp->lhs ) lhs = write_node( exp->lhs );
+			uint64_t rhs = write_node( exp->rhs );
+
+			serialize( out, dag_record_tag::operation );
+			serialize_varint( out, ( uint64_t( exp->op ) << 1 ) | exp->simplify_hint );
+			if ( lhs ) serialize_varint( out, node_count - 1 - *lhs );
+			serialize_varint( out, node_count - 1 - rhs );
+		}
+		// Write variables by their unique identifiers, memory variables refer to their base as a node.
+		//
+		else if ( exp->is_variable() )
+		{
+			// Validate the identifier before writing anything so that the stream is not left 
+			// with a partial record.
+			//
+			if ( !exp->uid.is<std::string>() && !exp->uid.is<symbolic::variable>() )
+				throw std::runtime_error( "Unique identifier cannot be serialized." );
+
+			std::optional<uint64_t> base;
+			if ( exp->uid.is<symbolic::variable>() && exp->uid.get<symbolic::variable>().is_memory() )
+				base = write_node( exp->uid.get<symbolic::variable>().mem().base.base );
+
+			serialize( out, dag_record_tag::variable );
+			serialize_varint( out, exp->size() );
+			if ( exp->uid.is<std::string>() )
+			{
+				serialize( out, identifier_tag::string );
+				auto& name = exp->uid.get<std::string>();
+				serialize_varint( out, name.size() );
+				out.write( name.data(), name.size() );
+			}
+			else
+			{
+				auto& var = exp->uid.get<symbolic::variable>();
+				serialize( out, identifier_tag::variable );
+
+				// Write the iterator as the entry point of the block and the index of the instruction.
+				//
+				if ( !var.at.is_valid() )
+				{
+					serialize( out, iterator_tag::none );
+				}
+				else if ( var.is_free_form() )
+				{
+					serialize( out, iterator_tag::free_form );
+				}
+				else
+				{
+					serialize( out, iterator_tag::bound );
+					serialize_varint( out, var.at.block->entry_vip );
+					serialize_varint( out, std::distance( var.at.block->begin(), var.at ) );
+				}
+
+				// Write the descriptor.
+				//
+				serialize_varint( out, ( var.descriptor.index() << 1 ) | var.is_branch_dependant );
+				if ( var.is_register() )
+				{
+					auto& reg = var.reg();
+					serialize_varint( out, reg.flags );
+					serialize_varint( out, reg.combined_id );
+					serialize_varint( out, reg.bit_count );
+					serialize_varint( out, reg.bit_offset );
+				}
+				else
+				{
+					serialize_varint( out, node_count - 1 - *base );
+					serialize_varint( out, var.mem().bit_count );
+				}
+			}
+		}
+		// Write constants sign extended and zigzag encoded so that small negative values stay small.
+		//
+		else
+		{
+			int64_t value = math::sign_extend( exp->value.known_one(), exp->size() );
+			serialize( out, dag_record_tag::constant );
+			serialize_varint( out, exp->size() );
+			serialize_varint( out, ( uint64_t( value ) << 1 ) ^ uint64_t( value >> 63 ) );
+		}
+
+		nodes.emplace( exp, node_count );
+		return node_count++;
+	}
+
+	expression_dag_reader::expression_dag_reader( std::istream& in, const routine* rtn, bool header ) : in( in ), rtn( rtn )
+	{
+		if ( !header )
+			return;
+
+		expression_dag_header hdr;
+		deserialize( in, hdr );
+		if ( hdr.magic_1 != expression_dag_header{}.magic_1 ||
+			 hdr.magic_2 != expression_dag_header{}.magic_2 ||
+			 hdr.version != expression_dag_header{}.version )
+			throw std::runtime_error( "Invalid expression graph header." );
+	}
+	bool expression_dag_reader::read( symbolic::expression::reference& out )
+	{
+		// Resolves a node referred to by its distance from the node being read.
+		//
+		auto resolve = [ & ] () -> const symbolic::expression::reference&
+		{
+			uint64_t distance = deserialize_varint( in );
+			if ( distance >= nodes.size() )
+				throw std::runtime_error( "Resolved invalid node." );
+			return nodes[ nodes.size() - 1 - distance ];
+		};
+		auto read_size = [ & ] ()
+		{
+			uint64_t bit_count = deserialize_varint( in );
+			if ( bit_count == 0 || bit_count > 64 )
+				throw std::runtime_error( "Resolved invalid size." );
+			return ( bitcnt_t ) bit_count;
+		};
+
+		while ( true )
+		{
+			// Stop if the stream ends at a record boundary.
+			//
+			if ( in.peek() == std::istream::traits_type::eof() )
+				return false;
+
+			dag_record_tag tag;
+			deserialize( in, tag );
+
+			// Read operations, do not simplify since the graph is preserved as is.
+			//
+			if ( tag == dag_record_tag::operation )
+			{
+				uint64_t op_and_hint = deserialize_varint( in );
+				auto op = math::operator_id( op_and_hint >> 1 );
+				if ( op <= math::operator_id::invalid || op >= math::operator_id::max )
+					throw std::runtime_error( "Resolved invalid operator." );
+
+				symbolic::expression::reference lhs;
+				if ( math::descriptor_of( op ).operand_count == 2 ) 
+					lhs = resolve();
+				auto& rhs = resolve();
+
+				auto exp = lhs ? symbolic::expression::make( std::move( lhs ), op, rhs )
+				               : symbolic::expression::make( op, rhs );
+				exp.simplify_hint = op_and_hint & 1;
+				nodes.emplace_back( std::move( exp ) );
+			}
+			// Read variables.
+			//
+			else if ( tag == dag_record_tag::variable )
+			{
+				bitcnt_t bit_count = read_size();
+				identifier_tag uid_tag;
+				deserialize( in, uid_tag );
+				if ( uid_tag == identifier_tag::string )
+				{
+					std::string name( deserialize_varint( in ), '\0' );
+					in.read( name.data(), name.size() );
+					if ( in.eof() || in.fail() )
+						throw std::out_of_range( "Reading past file end." );
+					nodes.emplace_back( symbolic::expression{ symbolic::unique_identifier{ std::move( name ) }, bit_count } );
+				}
+				else if ( uid_tag == identifier_tag::variable )
+				{
+					symbolic::variable var;
+
+					// Read the iterator and resolve it within the routine.
+					//
+					iterator_tag it_tag;
+					deserialize( in, it_tag );
+					if ( it_tag == iterator_tag::free_form )
+					{
+						var.at = symbolic::free_form_iterator;
+					}
+					else if ( it_tag == iterator_tag::bound )
+					{
+						vip_t vip = deserialize_varint( in );
+						uint64_t index = deserialize_varint( in );
+						if ( !rtn )
+							throw std::runtime_error( "Failed resolving block." );
+
+						auto it = rtn->explored_blocks.find( vip );
+						if ( it == rtn->explored_blocks.end() )
+							throw std::runtime_error( "Failed resolving block." );
+						const basic_block* blk = it->second;
+						if ( index > blk->size() )
+							throw std::runtime_error( "Failed resolving instruction." );
+						var.at = std::next( blk->begin(), index );
+					}
+					else if ( it_tag != iterator_tag::none )
+					{
+						throw std::runtime_error( "Resolved invalid iterator." );
+					}
+
+					// Read the descriptor.
+					//
+					uint64_t index_and_flag = deserialize_varint( in );
+					var.is_branch_dependant = index_and_flag & 1;
+					if ( ( index_and_flag >> 1 ) == 0 )
+					{
+						symbolic::variable::register_t reg;
+						reg.flags = ( register_flag ) deserialize_varint( in );
+						reg.combined_id = deserialize_varint( in );
+						reg.bit_count = read_size();
+						reg.bit_offset = ( bitcnt_t ) deserialize_varint( in );
+						var.descriptor = reg;
+					}
+					else if ( ( index_and_flag >> 1 ) == 1 )
+					{
+						auto& base = resolve();
+						var.descriptor = symbolic::variable::memory_t{ base, read_size() };
+					}
+					else
+					{
+						throw std::runtime_error( "Resolved invalid variable." );
+					}
+					nodes.emplace_back( symbolic::expression{ symbolic::unique_identifier{ std::move( var ) }, bit_count } );
+				}
+				else
+				{
+					throw std::runtime_error( "Resolved invalid unique identifier." );
+				}
+			}
+			// Read constants.
+			//
+			else if ( tag == dag_record_tag::constant )
+			{
+				bitcnt_t bit_count = read_size();
+				uint64_t zigzag = deserialize_varint( in );
+				int64_t value = int64_t( zigzag >> 1 ) ^ -int64_t( zigzag & 1 );
+				nodes.emplace_back( symbolic::expression{ math::zero_extend( value, bit_count ), bit_count } );
+			}
+			// Forget the nodes read so far.
+			//
+			else if ( tag == dag_record_tag::reset )
+			{
+				nodes.clear();
+			}
+			// Return the root referred to.
+			//
+			else if ( tag == dag_record_tag::root )
+			{
+				out = resolve();
+				return true;
+			}
+			else
+			{
+				throw std::runtime_error( "Resolved invalid record." );
+			}
+		}
+	}
 };
 #pragma warning(default:4267)
\ No newline at end of file
@@ -29,13 +29,17 @@
 #include <ostream>
 #include <istream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <optional>
+#include <unordered_map>
 #include "routine.hpp"
 #include "basic_block.hpp"
 #include "instruction.hpp"
 #include "call_convention.hpp"
+#include "../symex/variable.hpp"
 
 #pragma warning(disable:4267)
 namespace vtil
@@ -219,6 +223,62 @@ namespace vtil
 	void serialize( std::ostream& out, const operand& in );
 	void deserialize( std::istream& in, operand& out );
 
+	// Serialization of the simplifier cache shared between threads, entries are written as expression graphs and
+	// the ones that cannot be serialized or that refer to blocks of other routines are skipped. Caches created with
+	// different directive tables are rejected, returns the number of entries saved / loaded.
+	//
+	size_t save_simplifier_cache( std::ostream& out, const routine* rtn );
+	size_t load_simplifier_cache( std::istream& in, const routine* rtn );
+
+	// Streaming serialization of symbolic expression graphs, subtrees shared between the expressions 
+	// written are serialized once and referred to by index afterwards. Operators, sizes and indices are 
+	// varint-encoded and variables are written by their unique identifiers, variables bound to blocks 
+	// are resolved within the routine given to the reader.
+	//
+	struct expression_dag_writer
+	{
+		std::ostream& out;
+
+		// Nodes written so far and their indices.
+		//
+		std::unordered_map<symbolic::expression::reference, uint64_t, 
+			               symbolic::expression::reference::hasher, 
+			               symbolic::expression::reference::if_identical> nodes;
+		uint64_t node_count = 0;
+
+		// Writes the header, omitted if the graph is embedded into another format.
+		//
+		expression_dag_writer( std::ostream& out, bool header = true );
+
+		// Writes the expression, sharing the nodes written before.
+		//
+		void write( const symbolic::expression::reference& exp );
+
+		// Forgets the nodes written so far, used to bound the memory of long streams.
+		//
+		void reset();
+
+	private:
+		uint64_t write_node( const symbolic::expression::reference& exp );
+	};
+	struct expression_dag_reader
+	{
+		std::istream& in;
+		const routine* rtn;
+
+		// Nodes read so far.
+		//
+		std::vector<symbolic::expression::reference> nodes;
+
+		// Reads and validates the header, omitted if the graph is embedded into another format.
+		//
+		expression_dag_reader( std::istream& in, const routine* rtn = nullptr, bool header = true );
+
+		// Reads the next expression, returns false if the stream has ended.
+		//
+		bool read( symbolic::expression::reference& out );
+	};
+
 	// Simple wrappers for serialize / deserialize routine.
 	//
 	static void save_routine( const routine* rtn, const std::filesystem::path& path )
@@ -233,5 +293,37 @@ namespace vtil
 		deserialize( fs, rtn );
 		return rtn;
 	}
+	static size_t save_simplifier_cache( const routine* rtn, const std::filesystem::path& path )
+	{
+		std::ofstream fs( path, std::ios::binary );
+		return save_simplifier_cache( fs, rtn );
+	}
+	static size_t load_simplifier_cache( const routine* rtn, const std::filesystem::path& path )
+	{
+		// Read the whole file at once and deserialize from memory.
+		//
+		std::ifstream fs( path, std::ios::binary );
+		if ( !fs ) return 0;
+		std::stringstream ss;
+		ss << fs.rdbuf();
+		return load_simplifier_cache( ss, rtn );
+	}
+	static void save_expressions( const std::vector<symbolic::expression::reference>& exps, const std::filesystem::path& path )
+	{
+		std::ofstream fs( path, std::ios::binary );
+		expression_dag_writer writer{ fs };
+		for ( auto& exp : exps )
+			writer.write( exp );
+	}
+	static std::vector<symbolic::expression::reference> load_expressions( const routine* rtn, const std::filesystem::path& path )
+	{
+		std::ifstream fs( path, std::ios::binary );
+		expression_dag_reader reader{ fs, rtn };
+
+		std::vector<symbolic::expression::reference> exps;
+		for ( symbolic::expression::reference exp; reader.read( exp ); )
+			exps.emplace_back( std::move( exp ) );
+		return exps;
+	}
 };
 #pragma warning(default:4267)
\ No newline at end of file
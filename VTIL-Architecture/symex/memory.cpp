@@ -27,43 +27,210 @@
 //
 #include <vtil/math>
 #include "memory.hpp"
+#include <algorithm>
 
 namespace vtil::symbolic
 {
-	// Returns the mask of known/unknown bits of the given region, if alias failure occurs returns nullopt.
+	// Returns the key of the group the pointer belongs to.
 	//
-	std::optional<uint64_t> memory::known_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance ) const
+	static memory::group_key get_group_key( const pointer& ptr )
 	{
-		if ( auto value = unknown_mask( ptr, size, distance ) )
-			return math::fill( size ) & ~*value;
-		else
-			return std::nullopt;
+		memory::group_key key;
+		for ( size_t n = 0; n != key.size(); n++ )
+			key[ n ] = ptr.xvalues[ n + 1 ] - ptr.xvalues[ 0 ];
+		return key;
 	}
-	std::optional<uint64_t> memory::unknown_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance ) const
+
+	// Builds and drops the index.
+	//
+	void memory::build_index()
 	{
-		uint64_t mask_pending = math::fill( size );
+		drop_index();
+		index_valid = true;
+		last_stamp = 0;
+		for ( auto it = value_map.cbegin(); it != value_map.cend() && index_valid; it++ )
+			index_insert( it, last_stamp += stamp_interval );
+	}
+	void memory::drop_index()
+	{
+		index_valid = false;
+		groups.clear();
+		locations.clear();
+	}
+
+	// Inserts an entry into the index with the given stamp, fails the index if it does not fit in.
+	//
+	void memory::index_insert( store_type::const_iterator it, uint64_t stamp )
+	{
+		group_key key = get_group_key( it->first );
+		auto [git, inserted] = groups.try_emplace( key );
+		store_group& group = git->second;
+		if ( inserted )
+			group.origin = it->first;
+
+		// If the pointer is not at a known distance from the origin or does not share
+		// its flags, the group cannot describe it, fail the index.
+		//
+		std::optional offset = it->first - group.origin;
+		if ( !offset || it->first.flags != group.origin.flags )
+		{
+			index_failed = true;
+			drop_index();
+			return;
+		}
+
+		group.entries.emplace( *offset, store_record{ stamp, it } );
+		group.stamps.emplace( stamp );
+		locations.emplace( &*it, store_location{ key, *offset, stamp } );
+	}
+
+	// Removes an entry from the index, returns its stamp.
+	//
+	uint64_t memory::index_erase( store_type::const_iterator it )
+	{
+		auto loc = locations.find( &*it );
+		auto [key, offset, stamp] = loc->second;
+		locations.erase( loc );
+
+		auto git = groups.find( key );
+		store_group& group = git->second;
+		auto [begin, end] = group.entries.equal_range( offset );
+		group.entries.erase( std::find_if( begin, end, [ & ] ( auto& pair ) { return pair.second.it == it; } ) );
+		group.stamps.erase( group.stamps.find( stamp ) );
+		if ( group.entries.empty() )
+			groups.erase( git );
+		return stamp;
+	}
+
+	// Enumerates the entries overlapping the region from the newest to the oldest until the region is
+	// covered, clearing the covered bits from the mask and invoking the callback with the bit distance. 
+	// Returns false if an entry at an unknown distance is met before the region is covered.
+	//
+	bool memory::enum_overlapping( const pointer& ptr, uint64_t& mask_pending, fn_calc_distance distance, function_view<void( bitcnt_t, store_type::const_iterator )> fn ) const
+	{
+		// If no distance calculator is given, use the default one along with the index.
+		//
+		bool use_index = false;
+		if ( !distance )
+		{
+			distance = fn_calc_distance{ bit_distance };
+			use_index = index_valid;
+		}
 
-		// For each entry, iterating backwards:
+		// Visits the entry, returns false if the distance is unknown.
 		//
-		for ( auto it = value_map.rbegin(); it != value_map.rend() && mask_pending; it++ )
+		auto visit = [ & ] ( store_type::const_iterator it )
 		{
 			auto bit_distance = distance( it->first, ptr );
 
 			// If pointer cannot overlap lookup, skip.
 			//
 			if ( bit_distance.is_null() )
-				continue;
+				return true;
 
-			// If unknown:
+			// If unknown, fail.
 			//
 			if ( bit_distance.is_unknown() )
-				return std::nullopt;
+				return false;
 
-			// Calculate relative mask, clear pending mask.
+			// Calculate relative mask, skip if not overlapping.
 			//
 			uint64_t relative_mask = math::fill( it->second.size(), *bit_distance );
+			if ( !( relative_mask & mask_pending ) )
+				return true;
+
+			// Pass to the callback, clear the mask.
+			//
+			fn( *bit_distance, it );
 			mask_pending &= ~relative_mask;
+			return true;
+		};
+
+		// Find the group of the pointer, if there is one but the pointer cannot be placed
+		// within it, fall back to the linear search.
+		//
+		const store_group* group = nullptr;
+		int64_t offset = 0;
+		if ( use_index )
+		{
+			if ( auto git = groups.find( get_group_key( ptr ) ); git != groups.end() )
+			{
+				std::optional delta = ptr - git->second.origin;
+				if ( delta && ptr.flags == git->second.origin.flags )
+					group = &git->second, offset = *delta;
+				else
+					use_index = false;
+			}
+		}
+
+		// If we cannot use the index, iterate the store backwards.
+		//
+		if ( !use_index )
+		{
+			for ( auto it = value_map.rbegin(); it != value_map.rend() && mask_pending; it++ )
+				if ( !visit( std::prev( it.base() ) ) )
+					return false;
+			return true;
+		}
+
+		// Entries of the other groups are at an unknown distance, find the newest one that may alias.
+		//
+		uint64_t alias_stamp = 0;
+		for ( auto& [key, other] : groups )
+			if ( &other != group && other.origin.can_overlap( ptr ) )
+				alias_stamp = std::max( alias_stamp, *other.stamps.rbegin() );
+
+		// Collect the entries of our group close enough to overlap, no value being wider 
+		// than 64 bits, and sort them from the newest to the oldest.
+		//
+		stack_vector<store_record, 16> candidates;
+		if ( group )
+		{
+			auto collect = [ & ] ( int64_t low, int64_t high )
+			{
+				for ( auto it = group->entries.lower_bound( low ); it != group->entries.end() && it->first <= high; it++ )
+					candidates.emplace_back( it->second );
+			};
+			int64_t low = int64_t( uint64_t( offset ) - 7 );
+			int64_t high = int64_t( uint64_t( offset ) + 7 );
+			if ( low <= high )
+			{
+				collect( low, high );
+			}
+			else
+			{
+				collect( low, INT64_MAX );
+				collect( INT64_MIN, high );
+			}
+			std::sort( candidates.begin(), candidates.end(), [ ] ( auto& a, auto& b ) { return a.stamp > b.stamp; } );
+		}
+
+		// Visit each candidate, failing if we reach an aliasing entry first.
+		//
+		for ( auto& record : candidates )
+		{
+			if ( !mask_pending )
+				return true;
+			if ( record.stamp < alias_stamp || !visit( record.it ) )
+				return false;
 		}
+		return !mask_pending || !alias_stamp;
+	}
+
+	// Returns the mask of known/unknown bits of the given region, if alias failure occurs returns nullopt.
+	//
+	std::optional<uint64_t> memory::known_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance ) const
+	{
+		if ( auto value = unknown_mask( ptr, size, distance ) )
+			return math::fill( size ) & ~*value;
+		else
+			return std::nullopt;
+	}
+	std::optional<uint64_t> memory::unknown_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance ) const
+	{
+		uint64_t mask_pending = math::fill( size );
+		if ( !enum_overlapping( ptr, mask_pending, distance, [ ] ( bitcnt_t, store_type::const_iterator ) {} ) )
+			return std::nullopt;
 		return mask_pending;
 	}
 
@@ -78,42 +245,25 @@ namespace vtil::symbolic
 		uint64_t mask_pending = math::fill( size );
 		stack_vector<std::pair<bitcnt_t, expression::reference>, 8> merge_list;
 
-		// For each entry, iterating backwards:
+		// Add each overlapping entry into the merge list.
 		//
-		for ( auto it = value_map.rbegin(); it != value_map.rend() && mask_pending; it++ )
+		bool known = enum_overlapping( ptr, mask_pending, distance, [ & ] ( bitcnt_t dst, store_type::const_iterator it )
 		{
-			auto bit_distance = distance( it->first, ptr );
+			merge_list.emplace_back( dst, it->second );
+		} );
 
-			// If pointer cannot overlap lookup, skip.
-			//
-			if ( bit_distance.is_null() )
-				continue;
-
-			// If unknown:
+		// If an entry with unknown distance was met:
+		//
+		if ( !known )
+		{
+			// If not relaxed aliasing, indicate alias failure by returning null.
 			//
-			if ( bit_distance.is_unknown() )
-			{
-				// If not relaxed aliasing, indicate alias failure by returning null.
-				//
-				if ( !relaxed_aliasing )
-					return nullptr;
-
-				// Otherwise, return default value, cannot be determined.
-				//
-				merge_list.clear();
-				break;
-			}
+			if ( !relaxed_aliasing )
+				return nullptr;
 
-			// Calculate relative mask, skip if not overlapping.
+			// Otherwise, return default value, cannot be determined.
 			//
-			uint64_t relative_mask = math::fill( it->second.size(), *bit_distance );
-			if ( !( relative_mask & mask_pending ) )
-				continue;
-
-			// Add into merge list, clear the mask.
-			//
-			merge_list.emplace_back( *bit_distance, it->second );
-			mask_pending &= ~relative_mask;
+			merge_list.clear();
 		}
 
 		// If no overlapping keys found, return default.
@@ -149,45 +299,33 @@ namespace vtil::symbolic
 	//
 	optional_reference<expression::reference> memory::write( const pointer& ptr, deferred_value<expression::reference> value, bitcnt_t size, fn_calc_distance distance )
 	{
+		// Build the index if the store has grown large enough.
+		//
+		if ( !index_valid && !index_failed && value_map.size() >= index_threshold )
+			build_index();
+
 		uint64_t mask_pending = math::fill( size );
 		stack_vector<std::pair<bitcnt_t, store_type::iterator>, 8> acquisition_list;
 
-		// For each entry, iterating backwards:
+		// Add each overlapping entry into the acquisition list.
 		//
-		for ( auto it = value_map.rbegin(); it != value_map.rend() && mask_pending; it++ )
+		bool known = enum_overlapping( ptr, mask_pending, distance, [ & ] ( bitcnt_t dst, store_type::const_iterator it )
 		{
-			auto bit_distance = distance( it->first, ptr );
-
-			// If pointer cannot overlap lookup, skip.
-			//
-			if ( bit_distance.is_null() )
-				continue;
-
-			// If unknown:
-			//
-			if ( bit_distance.is_unknown() )
-			{
-				// If not relaxed aliasing, indicate alias failure by returning null.
-				//
-				if ( !relaxed_aliasing )
-					return std::nullopt;
+			acquisition_list.emplace_back( dst, value_map.erase( it, it ) );
+		} );
 
-				// Otherwise, insert at the end, overlaps can't be determined.
-				//
-				acquisition_list.clear();
-				break;
-			}
-
-			// Calculate relative mask, skip if not overlapping.
+		// If an entry with unknown distance was met:
+		//
+		if ( !known )
+		{
+			// If not relaxed aliasing, indicate alias failure by returning null.
 			//
-			uint64_t relative_mask = math::fill( it->second.size(), *bit_distance );
-			if ( !( relative_mask & mask_pending ) )
-				continue;
+			if ( !relaxed_aliasing )
+				return std::nullopt;
 
-			// Add into acquisition list, clear the mask.
+			// Otherwise, insert at the end, overlaps can't be determined.
 			//
-			acquisition_list.emplace_back( *bit_distance, std::prev( it.base() ) );
-			mask_pending &= ~relative_mask;
+			acquisition_list.clear();
 		}
 
 		// For each iterator we should acquire bits from:
@@ -207,15 +345,18 @@ namespace vtil::symbolic
 				//
 				if ( new_size <= 0 )
 				{
+					if ( index_valid ) index_erase( it );
 					value_map.erase( it );
 					continue;
 				}
 
-				// Shift and resize the entry.
+				// Shift and resize the entry, re-indexing it under the same stamp.
 				//
+				uint64_t stamp = index_valid ? index_erase( it ) : 0;
 				it->first = std::move( it->first ) + ( strip_low_cnt / 8 );
 				it->second >>= strip_low_cnt;
 				it->second.resize( new_size );
+				if ( index_valid ) index_insert( it, stamp );
 			}
 			// If high bits end before or at our region limits:
 			// |         v v v v |      v v v v	 |
@@ -239,12 +380,25 @@ namespace vtil::symbolic
 
 				// Split high value.
 				//
-				value_map.emplace(
+				auto high = value_map.emplace(
 					it,
 					it->first + ( high_offset / 8 ),
 					( it->second >> high_offset ).resize( high_size )
 				);
 
+				// Stamp it between its neighbours, if there is no room left drop 
+				// the index so that it gets rebuilt.
+				//
+				if ( index_valid )
+				{
+					uint64_t next = locations.at( &*it ).stamp;
+					uint64_t prev = high == value_map.begin() ? 0 : locations.at( &*std::prev( high ) ).stamp;
+					if ( ( next - prev ) > 1 )
+						index_insert( high, prev + ( next - prev ) / 2 );
+					else
+						drop_index();
+				}
+
 				// Resize low value.
 				//
 				it->second.resize( low_size );
@@ -253,6 +407,14 @@ namespace vtil::symbolic
 
 		// Insert new value.
 		//
-		return value_map.emplace_back( ptr, value.get() ).second;
+		auto& entry = value_map.emplace_back( ptr, value.get() );
+
+		// Index it, rebuilding the index if it was dropped or ran out of stamps.
+		//
+		if ( index_valid && last_stamp <= ( UINT64_MAX - stamp_interval ) )
+			index_insert( std::prev( value_map.cend() ), last_stamp += stamp_interval );
+		else if ( index_valid || ( !index_failed && value_map.size() >= index_threshold ) )
+			build_index();
+		return entry.second;
 	}
 };
\ No newline at end of file
@@ -28,6 +28,10 @@
 #pragma once
 #include <vtil/utility>
 #include <list>
+#include <map>
+#include <set>
+#include <array>
+#include <unordered_map>
 #include "pointer.hpp"
 #include "variable.hpp"
 #include "../arch/register_desc.hpp"
@@ -55,22 +59,71 @@ namespace vtil::symbolic
 			return byte_distance ? uncertain{ math::narrow_cast<bitcnt_t>( *byte_distance * 8 ) } : uncertain_t::unknown;
 		}
 
+		// Index of the store. Entries are grouped by the differences between the x values of their
+		// pointers, which are invariant under constant displacement, so pointers at a known distance 
+		// share a group while pointers of different groups can only be at an unknown distance. Entries
+		// of a group are ordered by their byte offset from the origin of the group and stamped in the 
+		// order of the store, so the entries overlapping a region are found without a full scan.
+		//
+		using group_key =                std::array<uint64_t, VTIL_SYMEX_XVAL_KEYS - 1>;
+		struct store_record
+		{
+			uint64_t stamp;
+			store_type::const_iterator it;
+		};
+		struct store_group
+		{
+			pointer origin;
+			std::multimap<int64_t, store_record> entries;
+			std::multiset<uint64_t> stamps;
+		};
+		struct store_location
+		{
+			group_key key;
+			int64_t offset;
+			uint64_t stamp;
+		};
+
+		// Stores smaller than this are searched linearly, stamps of new entries are spaced by 
+		// the interval so that split entries can be stamped in between.
+		//
+		static constexpr size_t index_threshold = 16;
+		static constexpr uint64_t stamp_interval = 1ull << 32;
+
 		// The memory state.
+		// - Pointers of the entries should not be modified externally as they are indexed.
 		//
 		bool relaxed_aliasing;
 		store_type value_map;
 
+		// The index state, built once the store grows beyond the threshold and dropped until reset
+		// if the pointers of a group turn out not to be at a known distance.
+		//
+		bool index_valid = false;
+		bool index_failed = false;
+		uint64_t last_stamp = 0;
+		std::unordered_map<group_key, store_group, hasher<>> groups;
+		std::unordered_map<const store_entry*, store_location> locations;
+
 		// Default constructor, optionally takes a boolean to indicate relaxed aliasing.
 		//
 		memory( bool relaxed_aliasing = false )
 			: relaxed_aliasing( relaxed_aliasing ) {}
 
-		// Default copy/move.
+		// Default move, copy rebuilds the index.
 		//
 		memory( memory&& ) = default;
-		memory( const memory& ) = default;
+		memory( const memory& o ) : relaxed_aliasing( o.relaxed_aliasing ), value_map( o.value_map ) { if ( o.index_valid ) build_index(); }
 		memory& operator=( memory&& ) = default;
-		memory& operator=( const memory& ) = default;
+		memory& operator=( const memory& o )
+		{
+			relaxed_aliasing = o.relaxed_aliasing;
+			value_map = o.value_map;
+			index_failed = false;
+			if ( o.index_valid ) build_index();
+			else                 drop_index();
+			return *this;
+		}
 
 		// Wrap around the store type.
 		//
@@ -79,21 +132,41 @@ namespace vtil::symbolic
 		auto begin() const { return value_map.cbegin(); }
 		auto end() const { return value_map.cend(); }
 		size_t size() const { return value_map.size(); }
-		void reset() { value_map.clear(); }
+		void reset() { value_map.clear(); drop_index(); index_failed = false; }
+
+		// Builds and drops the index.
+		//
+		void build_index();
+		void drop_index();
+
+		// Inserts an entry into the index with the given stamp, fails the index if it does not fit in.
+		//
+		void index_insert( store_type::const_iterator it, uint64_t stamp );
+
+		// Removes an entry from the index, returns its stamp.
+		//
+		uint64_t index_erase( store_type::const_iterator it );
+
+		// Enumerates the entries overlapping the region from the newest to the oldest until the region is
+		// covered, clearing the covered bits from the mask and invoking the callback with the bit distance. 
+		// Returns false if an entry at an unknown distance is met before the region is covered.
+		// - If no distance calculator is given, bit_distance is used along with the index.
+		//
+		bool enum_overlapping( const pointer& ptr, uint64_t& mask_pending, fn_calc_distance distance, function_view<void( bitcnt_t, store_type::const_iterator )> fn ) const;
 
 		// Returns the mask of known/unknown bits of the given region, if alias failure occurs returns nullopt.
 		// 
-		std::optional<uint64_t> known_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance = bit_distance ) const;
-		std::optional<uint64_t> unknown_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance = bit_distance ) const;
+		std::optional<uint64_t> known_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance = {} ) const;
+		std::optional<uint64_t> unknown_mask( const pointer& ptr, bitcnt_t size, fn_calc_distance distance = {} ) const;
 
 		// Reads N bits from the given pointer, returns null reference if alias failure occurs.
 		// - Will output the mask of bits contained in the state into contains if it does not fail.
 		//
-		expression::reference read( const pointer& ptr, bitcnt_t size, const il_const_iterator& reference_iterator = symbolic::free_form_iterator, uint64_t* contains = nullptr, fn_calc_distance distance = bit_distance ) const;
+		expression::reference read( const pointer& ptr, bitcnt_t size, const il_const_iterator& reference_iterator = symbolic::free_form_iterator, uint64_t* contains = nullptr, fn_calc_distance distance = {} ) const;
 
 		// Writes the given value to the pointer, returns null reference if alias failure occurs.
 		//
-		optional_reference<expression::reference> write( const pointer& ptr, deferred_value<expression::reference> value, bitcnt_t size, fn_calc_distance distance = bit_distance );
-		optional_reference<expression::reference> write( const pointer& ptr, expression::reference value, fn_calc_distance distance = bit_distance ) { return write( ptr, value, value.size(), std::move( distance ) ); }
+		optional_reference<expression::reference> write( const pointer& ptr, deferred_value<expression::reference> value, bitcnt_t size, fn_calc_distance distance = {} );
+		optional_reference<expression::reference> write( const pointer& ptr, expression::reference value, fn_calc_distance distance = {} ) { return write( ptr, value, value.size(), std::move( distance ) ); }
 	};
 };
\ No newline at end of file
@@ -127,10 +127,14 @@ namespace vtil::symbolic
 	//
 	std::optional<intptr_t> pointer::operator-( const pointer& o ) const
 	{
-		int64_t delta = xvalues[ 0 ] - o.xvalues[ 0 ];
+		// Accumulate the lanes that do not match the first delta without branching.
+		//
+		uint64_t delta = xvalues[ 0 ] - o.xvalues[ 0 ];
+		uint64_t mismatch = 0;
 		for ( size_t n = 1; n < xvalues.size(); n++ )
-			if ( ( xvalues[ n ] - o.xvalues[ n ] ) != delta )
-				return std::nullopt;
+			mismatch |= ( xvalues[ n ] - o.xvalues[ n ] ) ^ delta;
+		if ( mismatch )
+			return std::nullopt;
 		return ( base - o.base ).get<true>();
 	}
 
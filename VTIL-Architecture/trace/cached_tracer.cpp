@@ -55,11 +55,12 @@ namespace vtil
 			return result;
 		}
 
-		// Try lookup the exact variable in the map in a fast manner.
+		// Try lookup the exact variable in the shard of the block in a fast manner.
 		//
-		std::shared_lock lock{ mtx };
-		auto it = cache.find( lookup );
-		if ( it != cache.end() )
+		auto shard = get_shard( lookup.at.block );
+		std::shared_lock lock{ shard->mtx };
+		auto it = shard->cache.find( lookup );
+		if ( it != shard->cache.end() )
 		{
 			// If recursive flag is set, fix the expression:
 			//
@@ -130,13 +131,14 @@ namespace vtil
 		};
 
 
-		// Search the map, if we find a matching entry shrink and use as the result.
+		// Search the index, if we find a matching entry shrink and use as the result.
 		//
 		symbolic::expression::reference result;
-		it = std::find_if( cache.begin(), cache.end(), predicate );
-		if ( it != cache.end() )
+		auto [begin, end] = shard->index.equal_range( get_index_key( lookup ) );
+		auto match = std::find_if( begin, end, [ & ] ( auto& pair ) { return predicate( *pair.second ); } );
+		if ( match != end )
 		{
-			result = it->second;
+			result = match->second->second;
 			lock = {};
 			result.resize( lookup.bit_count() );
 		}
@@ -149,8 +151,9 @@ namespace vtil
 		// Insert a cache entry for the exact variable we're looking up and return.
 		//
 		{
-			std::unique_lock ulock{ mtx };
-			cache.emplace( lookup, result );
+			std::unique_lock ulock{ shard->mtx };
+			if ( auto [it, inserted] = shard->cache.emplace( lookup, result ); inserted )
+				shard->index.emplace( get_index_key( lookup ), &*it );
 		}
 
 	#if VTIL_OPT_TRACE_VERBOSE
@@ -160,4 +163,164 @@ namespace vtil
 	#endif
 		return result;
 	}
+
+	// Returns the shard of the block, replacing it with an empty one if the block 
+	// was modified since its creation.
+	//
+	std::shared_ptr<cached_tracer::cache_shard> cached_tracer::get_shard( const basic_block* blk ) const
+	{
+		// Try finding a valid shard under a shared lock first.
+		//
+		{
+			std::shared_lock lock{ mtx };
+			auto it = shards.find( blk );
+			if ( it != shards.end() && it->second->epoch == blk->epoch )
+				return it->second;
+		}
+
+		// Create a new shard otherwise, threads still holding the previous one will 
+		// finish using it and it will be freed with the last reference.
+		//
+		std::unique_lock lock{ mtx };
+		auto& shard = shards[ blk ];
+		if ( !shard || shard->epoch != blk->epoch )
+		{
+			shard = std::make_shared<cache_shard>();
+			shard->epoch = blk->epoch;
+		}
+		return shard;
+	}
+
+	// Marks the entries of the block valid for its current epoch if they were valid at [epoch], used when
+	// the block was modified in a way that does not change the results of the traces cached.
+	//
+	void cached_tracer::revalidate( const basic_block* blk, epoch_t epoch )
+	{
+		std::unique_lock lock{ mtx };
+		if ( auto it = shards.find( blk ); it != shards.end() && it->second->epoch == epoch )
+			it->second->epoch = blk->epoch;
+	}
+
+	// Inserts an entry into the cache, replacing the existing one if relevant.
+	//
+	void cached_tracer::insert( const symbolic::variable& var, const symbolic::expression::reference& exp )
+	{
+		auto shard = get_shard( var.at.block );
+		std::unique_lock lock{ shard->mtx };
+		if ( auto [it, inserted] = shard->cache.insert_or_assign( var, exp ); inserted )
+			shard->index.emplace( get_index_key( var ), &*it );
+	}
+
+	// Returns the number of entries in the cache.
+	//
+	size_t cached_tracer::size() const
+	{
+		std::shared_lock lock{ mtx };
+		size_t n = 0;
+		for ( auto& [blk, shard] : shards )
+		{
+			std::shared_lock slock{ shard->mtx };
+			n += shard->cache.size();
+		}
+		return n;
+	}
+
+	// Duplicates the shards of another tracer.
+	//
+	void cached_tracer::copy_shards( const cached_tracer& o )
+	{
+		std::shared_lock lock{ o.mtx };
+		shards.clear();
+		for ( auto& [blk, shard] : o.shards )
+		{
+			std::shared_lock slock{ shard->mtx };
+			auto copy = std::make_shared<cache_shard>();
+			copy->epoch = shard->epoch;
+			copy->cache = shard->cache;
+			copy->reindex();
+			shards.emplace( blk, std::move( copy ) );
+		}
+	}
+
+	// Rebuilds the index from the cache.
+	//
+	void cached_tracer::cache_shard::reindex()
+	{
+		index.clear();
+		for ( auto& entry : cache )
+			index.emplace( get_index_key( entry.first ), &entry );
+	}
+
+	// Invoked by the multivariate on each access, validates the shards against the routine.
+	//
+	routine_tracer& routine_tracer::update( const routine* rtn )
+	{
+		// If the context was copied along with the routine, the entries reference the blocks 
+		// of the original, drop them.
+		//
+		if ( owner != rtn )
+		{
+			flush();
+			memo.validate( invalid_epoch );
+			owner = rtn;
+			cfg_epoch = rtn->cfg_epoch;
+			return *this;
+		}
+
+		// If the control flow has changed, drop the shards of the blocks no longer in the routine.
+		//
+		std::lock_guard g{ rtn->mutex };
+		if ( std::exchange( cfg_epoch, rtn->cfg_epoch ) != rtn->cfg_epoch )
+		{
+			std::unordered_set<const basic_block*> blocks;
+			for ( auto& [vip, block] : *rtn )
+				blocks.emplace( block );
+
+			std::unique_lock lock{ mtx };
+			for ( auto it = shards.begin(); it != shards.end(); )
+			{
+				if ( blocks.contains( it->first ) )
+					++it;
+				else
+					it = shards.erase( it );
+			}
+		}
+		return *this;
+	}
+
+	// Hooks the cross-block tracer to share the memoized results across invocations.
+	//
+	symbolic::expression::reference routine_tracer::rtrace( const symbolic::variable& lookup )
+	{
+		// If the lookup does not belong to the routine, the results cannot be validated.
+		//
+		if ( !owner || !lookup.at.is_valid() || lookup.at.block->owner != owner )
+			return cached_tracer::rtrace( lookup );
+
+		// Drop the results if the routine was modified since, and trace.
+		//
+		epoch_t epoch = owner->epoch;
+		memo.validate( epoch );
+		return tracer::rtrace( lookup, memo, epoch );
+	}
+
+	// Returns the key of the variable in the index.
+	//
+	hash_t cached_tracer::get_index_key( const symbolic::variable& var )
+	{
+		// Registers are keyed by their identity and offset, ignoring the size.
+		//
+		if ( var.is_register() )
+		{
+			auto& reg = var.reg();
+			return make_hash( var.at, reg.flags, reg.combined_id, reg.bit_offset );
+		}
+		// Pointers are compared by equivalence rather than identity, so memory is keyed by
+		// the x values of the pointer which equivalent pointers share.
+		//
+		else
+		{
+			return make_hash( var.at, var.mem().decay()->xvalues() );
+		}
+	}
 };
\ No newline at end of file
@@ -29,6 +29,8 @@
 #include <vtil/symex>
 #include <vtil/common>
 #include <unordered_map>
+#include <memory>
+#include <unordered_set>
 #include <shared_mutex>
 #include "tracer.hpp"
 #include "../symex/variable.hpp"
@@ -46,12 +48,48 @@ namespace vtil
         using cache_type =  std::unordered_map<symbolic::variable, symbolic::expression::reference>;
         using cache_entry = cache_type::value_type;
 
-        // Declare the lookup map for the cache, mapping each variable to the
-        // result of the primitive tracer.
+        // Define the type of the secondary index, mapping the position and the identity of 
+        // each variable regardless of its size to the cache entries.
         //
-        mutable cache_type cache;
+        using index_type = std::unordered_multimap<hash_t, const cache_entry*>;
+
+        // Shard of the cache holding the entries of a single block, tagged with the epoch
+        // of the block at the time of its creation so that it is dropped once the block is 
+        // modified. Since a trace never leaves the block it starts at, entries of a block
+        // do not depend on the others.
+        //
+        struct cache_shard
+        {
+            // Epoch of the block the entries are valid for.
+            //
+            epoch_t epoch = invalid_epoch;
+
+            // Declare the lookup map for the entries, mapping each variable to the
+            // result of the primitive tracer.
+            //
+            cache_type cache;
+
+            // Declare the index of the entries, used to find an entry of a different 
+            // size at the same position if the exact lookup misses.
+            //
+            index_type index;
+
+            // Locks the shard.
+            //
+            relaxed<std::shared_mutex> mtx;
+
+            // Rebuilds the index from the cache.
+            //
+            void reindex();
+        };
+        using shard_map = std::unordered_map<const basic_block*, std::shared_ptr<cache_shard>>;
+
+        // Declare the shards of the cache, threads tracing different blocks do not
+        // contend on the same lock and a block can be invalidated at once.
+        //
+        mutable shard_map shards;
         
-        // Locks the cache.
+        // Locks the shard map.
         //
         mutable relaxed<std::shared_mutex> mtx;
 
@@ -63,26 +101,82 @@ namespace vtil
         //
         cached_tracer() {}
 
-        // Default copy/move.
+        // Default move, copy duplicates the shards.
         //
         cached_tracer( cached_tracer&& o ) = default;
-        cached_tracer( const cached_tracer& o ) = default;
+        cached_tracer( const cached_tracer& o ) : tracer( o ) { copy_shards( o ); }
         cached_tracer& operator=( cached_tracer&& o ) = default;
-        cached_tracer& operator=( const cached_tracer& o ) = default;
-        
-        // Flushes the cache.
+        cached_tracer& operator=( const cached_tracer& o ) { tracer::operator=( o ); copy_shards( o ); return *this; }
+
+        // Returns the shard of the block, replacing it with an empty one if the block 
+        // was modified since its creation.
+        //
+        std::shared_ptr<cache_shard> get_shard( const basic_block* blk ) const;
+
+        // Marks the entries of the block valid for its current epoch if they were valid at [epoch], used when
+        // the block was modified in a way that does not change the results of the traces cached.
+        // - [epoch] should be the epoch of the block right before the modification.
+        //
+        void revalidate( const basic_block* blk, epoch_t epoch );
+
+        // Inserts an entry into the cache, replacing the existing one if relevant.
+        //
+        void insert( const symbolic::variable& var, const symbolic::expression::reference& exp );
+
+        // Returns the number of entries in the cache.
         //
-        void flush() { cache.clear(); }
-        void flush( basic_block* blk )
+        size_t size() const;
+
+        // Invokes the enumerator passed for each entry in the cache.
+        //
+        template<typename T>
+        void enumerate( T&& fn ) const
         {
-            std::unique_lock lock{ mtx };
-            for ( auto it = cache.begin(); it != cache.end(); )
+            std::shared_lock lock{ mtx };
+            for ( auto& [blk, shard] : shards )
             {
-                if ( it->first.at.block == blk )
-                    it = cache.erase( it );
-                else
-                    it++;
+                std::shared_lock slock{ shard->mtx };
+                for ( auto& entry : shard->cache )
+                    if ( enumerator::invoke( fn, entry ).should_break )
+                        return;
             }
         }
+
+        // Returns the key of the variable in the index.
+        //
+        static hash_t get_index_key( const symbolic::variable& var );
+        
+        // Flushes the cache.
+        //
+        void flush() { std::unique_lock lock{ mtx }; shards.clear(); }
+        void flush( basic_block* blk ) { std::unique_lock lock{ mtx }; shards.erase( blk ); }
+
+    private:
+        void copy_shards( const cached_tracer& o );
 	};
+
+    // Routine-wide cached tracer stored in the multivariate context of the routine, shared
+    // by the optimization passes so that the traces of untouched blocks survive between them.
+    // - Shards of modified blocks are dropped by the epoch check of the cached tracer, shards
+    //   of blocks removed from the routine are pruned once its control flow changes.
+    //
+    struct routine_tracer : cached_tracer, mv_updatable_tag
+    {
+        // Routine the entries belong to and its control flow epoch at the time of the last prune.
+        //
+        const routine* owner = nullptr;
+        epoch_t cfg_epoch = invalid_epoch;
+
+        // Memoized results of the cross-block tracer, kept until the routine is modified.
+        //
+        rtrace_memo memo;
+
+        // Invoked by the multivariate on each access, validates the shards against the routine.
+        //
+        routine_tracer& update( const routine* rtn );
+
+        // Hooks the cross-block tracer to share the memoized results across invocations.
+        //
+        symbolic::expression::reference rtrace( const symbolic::variable& lookup ) override;
+    };
 };
@@ -34,11 +34,30 @@ namespace vtil
 {
 	// Internal type definitions.
 	//
-	using path_map_t = std::map<std::pair<const basic_block*, const basic_block*>, int>;
+	using path_map_t = rtrace_memo::path_map_t;
+
+	// State of a single invocation of the cross-block tracer.
+	//
+	struct rtrace_state
+	{
+		// Path history and the edges in it in the order they were first taken.
+		//
+		path_map_t path_map = {};
+		std::vector<rtrace_memo::edge_t> path_log = {};
+
+		// Memoized results and the epoch of the routine they are traced at.
+		//
+		rtrace_memo& memo;
+		epoch_t epoch;
+
+		// Block the lookup originates from.
+		//
+		const basic_block* target;
+	};
 
 	// Forward defs.
 	//
-	static symbolic::expression::reference rtrace_primitive( const symbolic::variable& lookup, tracer* tracer, path_map_t& path_map, const basic_block* target );
+	static symbolic::expression::reference rtrace_primitive( const symbolic::variable& lookup, tracer* tracer, rtrace_state& state );
 
 	// Given a partial tracer, this routine will determine the full value of the variable
 	// at the given position where a partial write was found.
@@ -162,12 +181,12 @@ namespace vtil
 		}, true, false );
 	}
 
-    // Propagates all variables in the reference expression onto the new iterator, if no history pointer given will do trace instead of rtrace.
+    // Propagates all variables in the reference expression onto the new iterator, if no state pointer given will do trace instead of rtrace.
 	// Returns an additional boolean parameter that indicates, if the propagation failed, it was due to a total failure or not; total failure
 	// meaning the origin expression was a variable and it infinite-looped during propagation by itself.
     // - Note: New iterator should be a connected block's end.
 	//
-    static bool propagate( symbolic::expression::reference& ref, const il_const_iterator& it, tracer* tracer, path_map_t* path_map, const basic_block* target )
+    static bool propagate( symbolic::expression::reference& ref, const il_const_iterator& it, tracer* tracer, rtrace_state* state )
     {
         using namespace logger;
 
@@ -228,7 +247,7 @@ namespace vtil
 				// Fail if propagation fails.
 				//
 				symbolic::expression::reference mem_ptr = std::move( mem.base.base );
-				propagate( mem_ptr, it, tracer->purify(), nullptr, nullptr );
+				propagate( mem_ptr, it, tracer->purify(), nullptr );
 				if ( !mem_ptr )
 				{
 					result = false;
@@ -250,8 +269,8 @@ namespace vtil
             // Trace the variable in the destination block, fail if it fails.
             //
 			symbolic::expression::reference var_traced;
-			if ( path_map )
-				var_traced = rtrace_primitive( var, tracer, *path_map, target );
+			if ( state )
+				var_traced = rtrace_primitive( var, tracer, *state );
 			else
 				var_traced = tracer->trace( var );
 			if ( !var_traced )
@@ -280,14 +299,36 @@ namespace vtil
 
 	// Internal implementation of ::rtrace with a path history.
 	//
-	static symbolic::expression::reference rtrace_primitive( const symbolic::variable& lookup, tracer* tracer, path_map_t& path_map, const basic_block* target )
+	static symbolic::expression::reference rtrace_primitive( const symbolic::variable& lookup, tracer* tracer, rtrace_state& state )
 	{
 		using namespace logger;
+		auto& path_map = state.path_map;
 
 		// Save whether this is the call whose result will reach the user.
 		//
 		bool initial_call = path_map.empty();
 
+		// If the variable was already traced with the same path history, replay the edges 
+		// the trace has taken for the first time and return the saved result.
+		//
+		rtrace_memo::counter_list counters;
+		for ( auto& [edge, counter] : path_map )
+			if ( counter != 0 )
+				counters.emplace_back( edge, counter );
+		if ( auto entry = state.memo.lookup( lookup, initial_call, counters, state.epoch ) )
+		{
+			for ( auto& edge : entry->new_edges )
+				if ( path_map.try_emplace( edge, 0 ).second )
+					state.path_log.emplace_back( edge );
+#if VTIL_OPT_TRACE_VERBOSE
+			// Log result.
+			//
+			log<CON_BLU>( "= %s [Memoized result]\n", entry->result );
+#endif
+			return entry->result;
+		}
+		size_t path_log_begin = state.path_log.size();
+
 		// Trace through the current block first.
 		//
 		auto result = tracer->trace( lookup );
@@ -329,10 +370,10 @@ namespace vtil
 					// Skip if it does not reach target.
 					//
 #if _DEBUG
-					if ( !target->owner->has_path( it.block, target ) )
+					if ( !state.target->owner->has_path( it.block, state.target ) )
 					{
 						warning( "Iterator %s has no path to %s but is still being considered in backpropagation.",
-							   it, target->begin() );
+							   it, state.target->begin() );
 					}
 #endif
 
@@ -351,7 +392,11 @@ namespace vtil
 					//
 					if ( potential_loop )
 					{
-						int& counter = path_map[ { lookup.at.block, it.block } ];
+						auto [entry, inserted] = path_map.try_emplace( { lookup.at.block, it.block }, 0 );
+						if ( inserted )
+							state.path_log.emplace_back( entry->first );
+
+						int& counter = entry->second;
 						if ( counter >= 2 )
 						{
 #if VTIL_OPT_TRACE_VERBOSE
@@ -372,7 +417,7 @@ namespace vtil
 					// Propagate each variable onto to the destination block, if total fail, skip path.
 					//
 					symbolic::expression::reference exp = default_result;
-					bool total_fail = propagate( exp, it, tracer, &path_map, target );
+					bool total_fail = propagate( exp, it, tracer, &state );
 					if ( potential_loop )
 						path_map[ { lookup.at.block, it.block } ]--;
 					if ( total_fail )
@@ -435,7 +480,17 @@ namespace vtil
 		//
 		log<CON_BRG>( "= %s\n", result );
 #endif
-		return result.simplify();
+		result.simplify();
+
+		// Save the result along with the state of the path history.
+		//
+		state.memo.insert( lookup, {
+			.initial = initial_call,
+			.counters = std::move( counters ),
+			.new_edges = { state.path_log.begin() + path_log_begin, state.path_log.end() },
+			.result = result
+		}, state.epoch );
+		return result;
 	}
 
 	// Traces a variable across the basic block it belongs to and generates a symbolic expression 
@@ -538,14 +593,66 @@ namespace vtil
 	// to trace backwards, any negative number implies infinite since it won't reach 0.
 	//
 	symbolic::expression::reference tracer::rtrace( const symbolic::variable& lookup )
+	{
+		rtrace_memo memo = {};
+		return rtrace( lookup, memo, invalid_epoch );
+	}
+
+	// Same as above but takes the memoization state to use, allowing the results to be 
+	// shared across invocations, the epoch given must be of the routine traced.
+	//
+	symbolic::expression::reference tracer::rtrace( const symbolic::variable& lookup, rtrace_memo& memo, epoch_t epoch )
 	{
 		bool recursive_flag_prev = std::exchange( recursive_flag, true );
-		path_map_t path_map = {};
-		auto exp = rtrace_primitive( lookup, this, path_map, lookup.at.block );
+		rtrace_state state = { .memo = memo, .epoch = epoch, .target = lookup.at.block };
+		auto exp = rtrace_primitive( lookup, this, state );
 		recursive_flag = recursive_flag_prev;
 		return exp;
 	}
 	
+	// Finds the entry matching the variable and the path history state given.
+	//
+	std::optional<rtrace_memo::entry> rtrace_memo::lookup( const symbolic::variable& var, bool initial, const counter_list& counters, epoch_t epoch ) const
+	{
+		std::shared_lock lock{ mtx };
+		if ( this->epoch != epoch )
+			return std::nullopt;
+
+		if ( auto it = entries.find( var ); it != entries.end() )
+		{
+			for ( auto& entry : it->second )
+				if ( entry.initial == initial && entry.counters == counters )
+					return entry;
+		}
+		return std::nullopt;
+	}
+
+	// Saves an entry for the variable if the epoch still matches.
+	//
+	void rtrace_memo::insert( const symbolic::variable& var, entry&& e, epoch_t epoch )
+	{
+		std::unique_lock lock{ mtx };
+		if ( this->epoch != epoch )
+			return;
+
+		// Skip if another thread has already saved the result.
+		//
+		auto& list = entries[ var ];
+		for ( auto& entry : list )
+			if ( entry.initial == e.initial && entry.counters == e.counters )
+				return;
+		list.emplace_back( std::move( e ) );
+	}
+
+	// Drops every entry if the epoch has changed.
+	//
+	void rtrace_memo::validate( epoch_t epoch )
+	{
+		std::unique_lock lock{ mtx };
+		if ( std::exchange( this->epoch, epoch ) != epoch )
+			entries.clear();
+	}
+
 	// Wrappers around trace and rtrace that can trace an entire expression.
 	//
 	symbolic::expression::reference tracer::trace_exp( const symbolic::expression::reference& exp )
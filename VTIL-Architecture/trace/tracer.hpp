@@ -27,6 +27,11 @@
 //
 #pragma once
 #include <vtil/symex>
+#include <map>
+#include <vector>
+#include <optional>
+#include <shared_mutex>
+#include <unordered_map>
 #include "../symex/variable.hpp"
 
 // [Configuration]
@@ -38,6 +43,59 @@
 
 namespace vtil
 {
+	// Memoization of the cross-block tracer. The result of tracing a variable propagated onto a
+	// predecessor depends only on the variable and the state of the path history, so each result
+	// is saved along with that state and paths joining at the same block are traced only once.
+	//
+	struct rtrace_memo
+	{
+		// Path history of the tracer, mapping each edge taken within a loop to the number of times
+		// it is currently being taken.
+		//
+		using edge_t = std::pair<const basic_block*, const basic_block*>;
+		using path_map_t = std::map<edge_t, int>;
+		using counter_list = std::vector<std::pair<edge_t, int>>;
+
+		struct entry
+		{
+			// State of the path history at the time of the trace, whether it was empty or not and
+			// the edges being taken along with their counters.
+			//
+			bool initial;
+			counter_list counters;
+
+			// Edges taken for the first time during the trace, replayed on a hit so that the 
+			// history is left identical.
+			//
+			std::vector<edge_t> new_edges;
+
+			// Result of the trace.
+			//
+			symbolic::expression::reference result;
+		};
+
+		// Epoch of the routine the entries are valid for.
+		//
+		epoch_t epoch = invalid_epoch;
+
+		// Entries of each variable and the lock guarding them.
+		//
+		std::unordered_map<symbolic::variable, std::vector<entry>> entries;
+		mutable relaxed<std::shared_mutex> mtx;
+
+		// Finds the entry matching the variable and the path history state given.
+		//
+		std::optional<entry> lookup( const symbolic::variable& var, bool initial, const counter_list& counters, epoch_t epoch ) const;
+
+		// Saves an entry for the variable if the epoch still matches.
+		//
+		void insert( const symbolic::variable& var, entry&& e, epoch_t epoch );
+
+		// Drops every entry if the epoch has changed.
+		//
+		void validate( epoch_t epoch );
+	};
+
 	// Basic tracer implementation.
 	//
 	struct tracer
@@ -56,6 +114,11 @@ namespace vtil
 		//
 		virtual symbolic::expression::reference rtrace( const symbolic::variable& lookup );
 
+		// Same as above but takes the memoization state to use, allowing the results to be 
+		// shared across invocations, the epoch given must be of the routine traced.
+		//
+		symbolic::expression::reference rtrace( const symbolic::variable& lookup, rtrace_memo& memo, epoch_t epoch );
+
 		// Wrappers around the functions above that return expressions with the registers packed.
 		//
 		symbolic::expression::reference trace_p( const symbolic::variable& lookup ) { return symbolic::variable::pack_all( trace( lookup ) ); }
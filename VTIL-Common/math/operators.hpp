@@ -207,10 +207,10 @@ namespace vtil::math
         {   +1,       false,    1,    false,          nullptr,    "__mask",      1      },
         {    0,       false,    1,    false,          nullptr,    "__bcnt",      1      },
         {    0,       false,    2,    false,          "?",        "if",          1      },
-        {    0,       false,    2,    true,           nullptr,    "max",         1      },
-        {    0,       false,    2,    true,           nullptr,    "min",         1      },
-        {    0,       true,     2,    true,           nullptr,    "umax",        1      },
-        {    0,       true,     2,    true,           nullptr,    "umin",        1      },
+        {    0,       true,     2,    true,           nullptr,    "max",         1      },
+        {    0,       true,     2,    true,           nullptr,    "min",         1      },
+        {    0,       false,    2,    true,           nullptr,    "umax",        1      },
+        {    0,       false,    2,    true,           nullptr,    "umin",        1      },
         {   -1,       true,     2,    false,          ">",        "greater",     1      },
         {   -1,       true,     2,    false,          ">=",       "greater_eq",  1.2    },
         {    0,       false,    2,    true,           "==",       "equal",       1      },
@@ -270,6 +270,8 @@ namespace vtil::math
             case operator_id::less:
             case operator_id::ugreater:
             case operator_id::ugreater_eq:
+            case operator_id::uequal:
+            case operator_id::unot_equal:
             case operator_id::uless_eq:
             case operator_id::uless:          return 1;
 
@@ -338,11 +340,11 @@ namespace vtil::math
             // if bcnt_res == 64, use __mulh, otherwise using >> bcnt_res(for example: 32)
             case operator_id::multiply_high:    result = bcnt_res == 64
                                                         ? mulh64( ilhs, irhs )
-                                                        : uint64_t( ilhs * irhs ) >> bcnt_res;                      break;
+                                                        : ( uint64_t( ilhs ) * uint64_t( irhs ) ) >> bcnt_res;      break;
             case operator_id::umultiply_high:   result = bcnt_res == 64
                                                         ? umulh64( lhs, rhs )
                                                         : ( lhs * rhs ) >> bcnt_res;                                break;
-            case operator_id::multiply:         result = ilhs * irhs;                                               break;
+            case operator_id::multiply:         result = uint64_t( ilhs ) * uint64_t( irhs );                       break;
             case operator_id::umultiply:        result = lhs * rhs;                                                 break;
 
             case operator_id::divide:           if( irhs == 0 ) result = INT64_MAX, warning("Division by immediate zero (IDIV).");
@@ -392,6 +394,84 @@ namespace vtil::math
         return { result & fill( bcnt_res ), bcnt_res };
     }
 
+    // Applies the specified operator [id] lane-wise on [n] left hand side values [lhs] and right hand side
+    // values [rhs], writing the masked results to [out]. [lhs] may be null for unary operators. Results are
+    // identical to evaluate(), but the common operators are dispatched once for all lanes so that the
+    // loops can be vectorized, the rest fall back to evaluating each lane individually.
+    //
+    static void evaluate_lanes( operator_id id, bitcnt_t bcnt_lhs, const uint64_t* lhs, bitcnt_t bcnt_rhs, const uint64_t* rhs, uint64_t* out, size_t n )
+    {
+        // Determine the normalization of the input, booleans are never sign extended.
+        //
+        const operator_desc& desc = descriptor_of( id );
+        bitcnt_t lhs_shift = ( lhs && bcnt_lhs != arch::bit_count && desc.operand_count != 1 ) ? arch::bit_count - bcnt_lhs : 0;
+        bitcnt_t rhs_shift = bcnt_rhs != arch::bit_count ? arch::bit_count - bcnt_rhs : 0;
+        bool lhs_signed = desc.is_signed && bcnt_lhs != 1;
+        bool rhs_signed = desc.is_signed && bcnt_rhs != 1;
+
+        // Invokes the operation on each lane with the normalized input, the mask of the output is only
+        // determined here as result_size() does not describe the resizing operators left to evaluate().
+        //
+        auto for_each_lane = [ & ] ( auto&& fn )
+        {
+            uint64_t result_mask = fill( result_size( id, bcnt_lhs, bcnt_rhs ) );
+            for ( size_t i = 0; i != n; i++ )
+            {
+                uint64_t vlhs = lhs ? lhs[ i ] : 0;
+                uint64_t vrhs = rhs[ i ];
+                vlhs = lhs_signed ? uint64_t( int64_t( vlhs << lhs_shift ) >> lhs_shift ) : ( vlhs << lhs_shift ) >> lhs_shift;
+                vrhs = rhs_signed ? uint64_t( int64_t( vrhs << rhs_shift ) >> rhs_shift ) : ( vrhs << rhs_shift ) >> rhs_shift;
+                out[ i ] = fn( vlhs, vrhs ) & result_mask;
+            }
+        };
+
+        switch ( id )
+        {
+            case operator_id::bitwise_not:      for_each_lane( [ ] ( uint64_t, uint64_t b ) { return ~b; } );                      break;
+            case operator_id::bitwise_and:      for_each_lane( [ ] ( uint64_t a, uint64_t b ) { return a & b; } );                  break;
+            case operator_id::bitwise_or:       for_each_lane( [ ] ( uint64_t a, uint64_t b ) { return a | b; } );                  break;
+            case operator_id::bitwise_xor:      for_each_lane( [ ] ( uint64_t a, uint64_t b ) { return a ^ b; } );                  break;
+            case operator_id::shift_right:      for_each_lane( [ = ] ( uint64_t a, uint64_t b ) 
+                                                                { return b >= uint64_t( bcnt_lhs ) ? 0 : a >> b; } );               break;
+            case operator_id::shift_left:       for_each_lane( [ = ] ( uint64_t a, uint64_t b ) 
+                                                                { return b >= uint64_t( bcnt_lhs ) ? 0 : a << b; } );               break;
+            case operator_id::negate:           for_each_lane( [ ] ( uint64_t, uint64_t b ) { return 0 - b; } );                    break;
+            case operator_id::add:              for_each_lane( [ ] ( uint64_t a, uint64_t b ) { return a + b; } );                  break;
+            case operator_id::subtract:         for_each_lane( [ ] ( uint64_t a, uint64_t b ) { return a - b; } );                  break;
+            case operator_id::multiply:
+            case operator_id::umultiply:        for_each_lane( [ ] ( uint64_t a, uint64_t b ) { return a * b; } );                  break;
+            default:
+                for ( size_t i = 0; i != n; i++ )
+                    out[ i ] = evaluate( id, bcnt_lhs, lhs ? lhs[ i ] : 0, bcnt_rhs, rhs[ i ] ).first;
+                break;
+        }
+    }
+
+    // Evaluates the comparison [op] given the range of values left hand side and right hand side can take,
+    // returns a single bit that is unknown if the ranges overlap in a way that does not determine the result.
+    //
+    template<typename T>
+    static constexpr bit_vector evaluate_range_comparison( operator_id op, T lhs_min, T lhs_max, T rhs_min, T rhs_max )
+    {
+        // Swap the operands of > and >= to reduce them into < and <=.
+        //
+        bool is_greater = op == operator_id::greater || op == operator_id::greater_eq || 
+                          op == operator_id::ugreater || op == operator_id::ugreater_eq;
+        if ( is_greater )
+        {
+            std::swap( lhs_min, rhs_min );
+            std::swap( lhs_max, rhs_max );
+        }
+
+        // If the entire range satisfies the comparison return one, if no value does return zero.
+        //
+        bool is_strict = op == operator_id::less || op == operator_id::greater ||
+                         op == operator_id::uless || op == operator_id::ugreater;
+        if ( is_strict ? lhs_max < rhs_min : lhs_max <= rhs_min ) return bit_vector( 1, 1 );
+        if ( is_strict ? lhs_min >= rhs_max : lhs_min > rhs_max ) return bit_vector( 0, 1 );
+        return bit_vector( 1 );
+    }
+
     // Applies the specified operator [op] on left hand side [lhs] and right hand side [rhs] where
     // input and output values are expressed in the format of bit-vectors with optional unknowns,
     // and no size constraints.
@@ -488,9 +568,18 @@ namespace vtil::math
                     //
                     return { lhs.known_one() >> shr_count, lhs.unknown_mask() >> shr_count, lhs.size() };
                 }
-                // If shift count is unknown, return unknown bit-vector or 0 if input was only consisting of zeros.
+                // If shift count is unknown, it is at least the known bits of it, so bits above the highest
+                // bit that can be set shifted by the minimum count are known to be zero.
                 //
-                return lhs.all_zero() ? lhs : bit_vector( lhs.size() );
+                else
+                {
+                    uint64_t min_count = rhs.known_one();
+                    if ( min_count >= ( uint64_t ) lhs.size() ) return bit_vector( 0, lhs.size() );
+                    uint64_t ones = lhs.known_one() | lhs.unknown_mask();
+                    ones |= ones >> 1;  ones |= ones >> 2;  ones |= ones >> 4;
+                    ones |= ones >> 8;  ones |= ones >> 16; ones |= ones >> 32;
+                    return { 0, ones >> min_count, lhs.size() };
+                }
 
             case operator_id::shift_left:
                 // If shift count is known:
@@ -506,9 +595,16 @@ namespace vtil::math
                     //
                     return { lhs.known_one() << shl_count, lhs.unknown_mask() << shl_count, lhs.size() };
                 }
-                // If shift count is unknown, return unknown bit-vector or 0 if input was only consisting of zeros.
+                // If shift count is unknown, it is at least the known bits of it, so bits below the lowest
+                // bit that can be set shifted by the minimum count are known to be zero.
                 //
-                return lhs.all_zero() ? lhs : bit_vector( lhs.size() );
+                else
+                {
+                    uint64_t min_count = rhs.known_one();
+                    if ( min_count >= ( uint64_t ) lhs.size() ) return bit_vector( 0, lhs.size() );
+                    uint64_t ones = lhs.known_one() | lhs.unknown_mask();
+                    return { 0, ( ones | ( 0 - ones ) ) << min_count, lhs.size() };
+                }
 
             case operator_id::rotate_right:
                 // If rotation count is known, return rotated masks, vector will normalize rest.
@@ -548,113 +644,39 @@ namespace vtil::math
                 
             //
             // Arithmetic operators:
-            // - TODO: Re-implement *fixed* O(1) solution for ADD SUB and NEG.
             //
             // ####################################################################################################################################
             case operator_id::add:
-            {
-                    bitcnt_t out_size = std::max( lhs.size(), rhs.size() );
-
-                    // Return unknown if no bits are known from one side.
-                    //
-                    if( lhs.unknown_mask() == lhs.value_mask() ||
-                        rhs.unknown_mask() == rhs.value_mask() )
-                        return bit_vector( out_size );
-
-                    // Create the temp holding the new bit vector.
-                    //
-                    uint64_t known_mask = 0;
-                    uint64_t unknown_mask = 0;
-
-                    // For each bit in the output size:
-                    //
-                    bit_vector lhs_sx = bit_vector{ lhs }.resize( out_size, true );
-                    bit_vector rhs_sx = bit_vector{ rhs }.resize( out_size, true );
-                    bit_state carry = bit_state::zero;
-                    for ( int i = 0; i < out_size; i++ )
-                    {
-                        // Get current bits and choose the branch depending on the type:
-                        //
-                        bit_state a = lhs_sx[ i ];
-                        bit_state b = rhs_sx[ i ];
-                        if ( const int unk_count = ( a == bit_state::unknown ) + ( b == bit_state::unknown ) + ( carry == bit_state::unknown ) )
-                        {
-                            const int one_count = ( a == bit_state::one ) + ( b == bit_state::one ) + ( carry == bit_state::one );
-                            const int zero_count = 3 - one_count - unk_count;
-                        
-                            // Carry is one if 2 elements are 1, zero if 2 elements are zero
-                            // and unknown otherise.
-                            //
-                            if ( one_count == 2 )       carry = bit_state::one;
-                            else if ( zero_count == 2 ) carry = bit_state::zero;
-                            else                        carry = bit_state::unknown;
-
-                            // Output is always unknown.
-                            //
-                            unknown_mask |= 1ull << i;
-                        }
-                        else if ( a == b )
-                        {
-                            // Duplicated element propagates as carry, output is current carry.
-                            //
-                            known_mask |= uint64_t( carry == bit_state::one ) << i;
-                            carry = a;
-                        }
-                        else if ( a != b )
-                        {
-                            // Carry propagates as is, output is inverse of current carry.
-                            //
-                            known_mask |= uint64_t( carry == bit_state::zero ) << i;
-                        }
-                    }
-                    return bit_vector( known_mask, unknown_mask, out_size );
-
-                    /*a = ( lhs.unknown_mask() | lhs.known_one() ) + ( rhs.unknown_mask() | rhs.known_one() );
-                    b = ( lhs.known_one()                      ) + ( rhs.known_one()                      );
-
-                    return
-                    {
-                        a & b,
-                        ~( a & b ) & ~( ~a & ~b ),
-                        std::max( lhs.size(), rhs.size() )
-                    };
-                    break;*/
-            }
-
+            case operator_id::subtract:
             case operator_id::negate:
+            {
                 // -A = 0-A
                 //
-                return evaluate_partial( operator_id::subtract, { 0, rhs.size() }, rhs );
-                
-                /*a = mask( rhs.size() ) & -__sx64( ( rhs.unknown_mask() | rhs.known_one() ), rhs.size() );
-                b = mask( rhs.size() ) & -__sx64( ( rhs.known_one() ),                      rhs.size() );
+                bitcnt_t out_size = op == operator_id::negate ? rhs.size() : std::max( lhs.size(), rhs.size() );
+                bit_vector lhs_sx = op == operator_id::negate ? bit_vector{ 0, out_size } : bit_vector{ lhs }.resize( out_size, true );
+                bit_vector rhs_sx = bit_vector{ rhs }.resize( out_size, true );
 
-                return 
-                {
-                    a & b,
-                    ~( a & b ) & ~( ~a & ~b ),
-                    rhs.size()
-                };
-                break;*/
-            case operator_id::subtract:
-                // A-B = ~(~A+B)
+                // Calculate the result of the operation on the known bits along with the lowest and the highest
+                // result the unknown bits can produce, any bit that differs between the two is affected by an
+                // unknown carry, and any bit with an unknown input is unknown as well.
                 //
-                return  evaluate_partial( operator_id::bitwise_not, {},
-                                          evaluate_partial( operator_id::add,
-                                            evaluate_partial( operator_id::bitwise_not, {}, lhs ),
-                                            rhs ) );
-                
-                /*a = ( lhs.unknown_mask() | lhs.known_one() ) - ( rhs.known_one()                      );
-                b = ( lhs.known_one()                      ) - ( rhs.unknown_mask() | rhs.known_one() );
-
-                return
+                uint64_t result, lower, upper;
+                if ( op == operator_id::add )
                 {
-                    a & b,
-                    ~( a & b ) & ~( ~a & ~b ),
-                    std::max( lhs.size(), rhs.size() )
-                };
-                break;*/
-            
+                    result = lhs_sx.known_one() + rhs_sx.known_one();
+                    lower = result;
+                    upper = result + lhs_sx.unknown_mask() + rhs_sx.unknown_mask();
+                }
+                else
+                {
+                    result = lhs_sx.known_one() - rhs_sx.known_one();
+                    lower = result - rhs_sx.unknown_mask();
+                    upper = result + lhs_sx.unknown_mask();
+                }
+                uint64_t unknown_mask = ( lower ^ upper ) | lhs_sx.unknown_mask() | rhs_sx.unknown_mask();
+                return bit_vector( result, unknown_mask, out_size );
+            }
+
             //
             // Bitwise specials.
             //
@@ -737,24 +759,22 @@ namespace vtil::math
                 bit_vector lhs_sx = bit_vector{ lhs }.resize(out_size, true);
                 bit_vector rhs_sx = bit_vector{ rhs }.resize(out_size, true);
                 bit_vector result = bit_vector(0, out_size);
-                for (int i = 0; i < rhs.size(); i++)
+                for (int i = 0; i < rhs.size() && result.unknown_mask() != result.value_mask(); i++)
                 {
+                    // Add the shifted LHS if the bit is set, if it is unknown so is every bit the LHS could set.
+                    //
                     bit_state b = rhs_sx[i];
                     if (b == bit_state::unknown)
                     {
                         result = evaluate_partial(operator_id::add,
-                                evaluate_partial(operator_id::shift_left, 
-                                            bit_vector(out_size),
-                                            bit_vector(i, out_size))
-                            , result);
+                            bit_vector(0, (lhs_sx.known_one() | lhs_sx.unknown_mask()) << i, out_size),
+                            result);
                     }
                     else if (b == bit_state::one)
                     {
                         result = evaluate_partial(operator_id::add,
-                            evaluate_partial(operator_id::shift_left,
-                                lhs_sx,
-                                bit_vector(i, out_size))
-                            , result);
+                            bit_vector(lhs_sx.known_one() << i, lhs_sx.unknown_mask() << i, out_size),
+                            result);
                     }
                 }
                 return result;
@@ -806,49 +826,21 @@ namespace vtil::math
             case operator_id::less_eq:
             case operator_id::less:
             {
-                // Fail if sign bits are not known
-                //
-                bit_state rhs_sign = rhs[ rhs.size() - 1 ];
-                if ( rhs_sign == bit_state::unknown )  return bit_vector( 1 );
-                bit_state lhs_sign = lhs[ lhs.size() - 1 ];
-                if ( lhs_sign == bit_state::unknown )  return bit_vector( 1 );
-
-                // If LHS is negative and RHS is positive, <, <= wins.
-                //
-                if ( lhs_sign == bit_state::one && rhs_sign == bit_state::zero )
-                    return bit_vector( op == operator_id::less || op == operator_id::less_eq, 1 );
-
-                // If RHS is negative and LHS is positive, >, >= wins.
+                // Determine the range of both sides, unknown sign bit is set for the minimum and cleared for the maximum,
+                // booleans are never sign extended.
                 //
-                if ( rhs_sign == bit_state::one && lhs_sign == bit_state::zero )
-                    return bit_vector( op == operator_id::greater || op == operator_id::greater_eq, 1 );
-
-                // For each bit index we should compare:
-                //
-                bitcnt_t cmp_size = std::max( lhs.size(), rhs.size() );
-                bit_vector lhs_sx = bit_vector{ lhs }.resize( cmp_size, true );
-                bit_vector rhs_sx = bit_vector{ rhs }.resize( cmp_size, true );
-                for ( int i = cmp_size - 1; i >= 0; i-- )
+                auto range_of = [ ] ( const bit_vector& v ) -> std::pair<int64_t, int64_t>
                 {
-                    // If any of the bits are unknown, result is unknown.
-                    //
-                    if ( lhs_sx[ i ] == bit_state::unknown || rhs_sx[ i ] == bit_state::unknown )
-                        return bit_vector( 1 );
-
-                    // If LHS is one and RHS is zero, >, >= and != wins.
-                    //
-                    if ( lhs_sx[ i ] == bit_state::one && rhs_sx[ i ] == bit_state::zero )
-                        return bit_vector( op == operator_id::greater || op == operator_id::greater_eq, 1 );
-
-                    // If RHS is one and LHS is zero, <, <= and != wins.
-                    //
-                    if ( rhs_sx[ i ] == bit_state::one && lhs_sx[ i ] == bit_state::zero )
-                        return bit_vector( op == operator_id::less || op == operator_id::less_eq, 1 );
-                }
-
-                // If completely equivalent (when sign extended), <=, >= wins.
-                //
-                return bit_vector( op == operator_id::less_eq || op == operator_id::greater_eq, 1 );
+                    bitcnt_t shift = v.size() == 1 ? 0 : arch::bit_count - v.size();
+                    uint64_t sign = v.size() == 1 ? 0 : 1ull << ( v.size() - 1 );
+                    return {
+                        int64_t( ( v.known_one() | ( v.unknown_mask() & sign ) ) << shift ) >> shift,
+                        int64_t( ( v.known_one() | ( v.unknown_mask() & ~sign ) ) << shift ) >> shift
+                    };
+                };
+                auto [ lhs_min, lhs_max ] = range_of( lhs );
+                auto [ rhs_min, rhs_max ] = range_of( rhs );
+                return evaluate_range_comparison( op, lhs_min, lhs_max, rhs_min, rhs_max );
             }
             
             //
@@ -899,29 +891,10 @@ namespace vtil::math
             case operator_id::ugreater_eq:
             case operator_id::uless_eq:
             case operator_id::uless:
-                // For each bit index we should compare:
-                //
-                for ( int i = std::max( lhs.size(), rhs.size() ) - 1; i >= 0; i-- )
-                {
-                    // If any of the bits are unknown, result is unknown.
-                    //
-                    if ( lhs[ i ] == bit_state::unknown || rhs[ i ] == bit_state::unknown ) 
-                        return bit_vector( 1 );
-
-                    // If LHS is one and RHS is zero, >, >= wins.
-                    //
-                    if ( lhs[ i ] == bit_state::one && rhs[ i ] == bit_state::zero ) 
-                        return bit_vector( op == operator_id::ugreater || op == operator_id::ugreater_eq, 1 );
-
-                    // If RHS is one and LHS is zero, <, <= wins.
-                    //
-                    if ( rhs[ i ] == bit_state::one && lhs[ i ] == bit_state::zero ) 
-                        return bit_vector( op == operator_id::uless || op == operator_id::uless_eq, 1 );
-                }
-
-                // If completely equivalent (when zero extended), <=, >= wins.
+                // Unknown bits are cleared for the minimum and set for the maximum.
                 //
-                return bit_vector( op == operator_id::uless_eq || op == operator_id::ugreater_eq, 1 );
+                return evaluate_range_comparison( op, lhs.known_one(), lhs.known_one() | lhs.unknown_mask(), 
+                                                      rhs.known_one(), rhs.known_one() | rhs.unknown_mask() );
             
             //
             // Unsigned equality checks:
@@ -34,6 +34,19 @@
 #include "object_pool.hpp"
 #include "../util/intrinsics.hpp"
 #include "../util/type_helpers.hpp"
+#include "../util/transform_parallel.hpp"
+
+// [Configuration]
+// Determine whether or not the reference counters are updated atomically.
+//  - Can only be disabled if shared references never cross thread boundaries, which also 
+//    requires parallel transformations to be disabled. The simplifier's worker threads run
+//    inline in that case, and the shared simplifier cache and the interning table, which
+//    hand nodes between the threads using VTIL, are disabled as well.
+//
+#ifndef VTIL_SHARED_REFERENCE_ATOMIC
+	#define VTIL_SHARED_REFERENCE_ATOMIC true
+#endif
+static_assert( VTIL_SHARED_REFERENCE_ATOMIC || !VTIL_USE_PARALLEL_TRANSFORM, "Thread-confined references cannot be used with parallel transformations." );
 
 // The copy-on-write interface defined here is used to avoid deep duplications of 
 // containers such as trees when a VTIL routine is working with them.
@@ -94,11 +107,14 @@ namespace vtil
 		using object_entry =   std::pair<T, std::atomic<long>>;
 		using object_pool  =   object_pool<object_entry>;
 
-		// Wrap atomic operations on reference counter.
+		// Wrap atomic operations on reference counter, if thread-confined, the 
+		// counter is updated with plain loads and stores instead.
 		//
 		__forceinline static void inc_ref( object_entry* entry )
 		{
-#ifdef _MSC_VER
+#if !VTIL_SHARED_REFERENCE_ATOMIC
+			entry->second.store( entry->second.load( std::memory_order::relaxed ) + 1, std::memory_order::relaxed );
+#elif defined(_MSC_VER)
 			std::atomic_fetch_add_explicit( &entry->second, +1, std::memory_order::relaxed );
 #else
 			entry->second++;
@@ -106,7 +122,11 @@ namespace vtil
 		}
 		__forceinline static bool dec_ref( object_entry* entry )
 		{
-#ifdef _MSC_VER
+#if !VTIL_SHARED_REFERENCE_ATOMIC
+			long value = entry->second.load( std::memory_order::relaxed ) - 1;
+			entry->second.store( value, std::memory_order::relaxed );
+			return value == 0;
+#elif defined(_MSC_VER)
 			return std::atomic_fetch_add_explicit( &entry->second, -1, std::memory_order::acq_rel ) == 1;
 #else
 			return --entry->second == 0;
@@ -114,7 +134,7 @@ namespace vtil
 		}
 		__forceinline static long get_ref( object_entry* entry )
 		{
-#ifdef _MSC_VER
+#if !VTIL_SHARED_REFERENCE_ATOMIC || defined(_MSC_VER)
 			return std::atomic_load_explicit( &entry->second, std::memory_order::relaxed );
 #else
 			return entry->second.load();
@@ -34,13 +34,26 @@
 #include "lt_typeid.hpp"
 #include "../io/formatting.hpp"
 #include "fnv64.hpp"
+#include "wy64.hpp"
+
+// [Configuration]
+// Determine whether hashes are computed with wyhash-style multiply-fold mixing or with FNV-1 
+// and the rotation based combination.
+//
+#ifndef VTIL_USE_WYHASH
+	#define VTIL_USE_WYHASH 1
+#endif
 
 namespace vtil
 {
 	// Declare hash type.
 	//
 	#define VTIL_HASH_SIZE 64
+#if VTIL_USE_WYHASH
+	using hash_t = vtil::wy64_hash_t;
+#else
 	using hash_t = vtil::fnv64_hash_t;
+#endif
 
 	// VTIL hashable types implement [hash_t T::hash() const];
 	//
@@ -87,6 +100,10 @@ namespace vtil
 	//
 	__forceinline static constexpr hash_t combine_hash( hash_t a, const hash_t& b )
 	{
+#if VTIL_USE_WYHASH
+		a.value[ 0 ] = hash_t::mix( a.value[ 0 ] ^ hash_t::secret[ 2 ], b.value[ 0 ] ^ hash_t::secret[ 1 ] );
+		return a;
+#else
 		constexpr auto rotl64 = [ ] ( uint64_t x, int r )
 		{
 			return ( x << r ) | ( x >> ( 64 - r ) );
@@ -94,6 +111,7 @@ namespace vtil
 		a.value[ 0 ] = rotl64( a.value[ 0 ] + b.value[ 0 ], 21 );
 		a.value[ 0 ] -= b.value[ 0 ] ^ impl::hash_combination_keys[ a.value[ 0 ] & 63 ];
 		return a;
+#endif
 	}
 	__forceinline static constexpr hash_t combine_unordered_hash( hash_t a, const hash_t& b )
 	{
@@ -106,6 +106,11 @@ namespace vtil
 		bool has_value() const { return traits != nullptr; }
 		operator bool() const { return has_value(); }
 
+		// Checks whether the variant is holding a value of the given type.
+		//
+		template<typename T>
+		bool is() const { return traits == vtype_traits_v<T>; }
+
 		// Gets the address of the object with the given properties.
 		//
 		void* get_address() { return is_inline ? ( void* ) &inl[ 0 ] : ( void* ) ext; }
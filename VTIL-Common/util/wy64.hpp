@@ -0,0 +1,156 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#pragma once
+#include <string>
+#include <array>
+#include <functional>
+#include <cstring>
+#include "intrinsics.hpp"
+#include "type_helpers.hpp"
+#include "../io/formatting.hpp"
+
+namespace vtil
+{
+	// Defines a 64-bit hash type based on the multiply-fold mixing of wyhash.
+	//
+	struct wy64_hash_t
+	{
+		// Magic constants for wyhash.
+		//
+		using value_t = uint64_t;
+		static constexpr value_t default_seed = { 0xCBF29CE484222325 };
+		static constexpr value_t secret[] = { 0xa0761d6478bd642f, 0xe7037ed1a0b428db, 0x8ebc6af09c88c6e3, 0x589965cc75374cc3 };
+
+		// Current value of the hash.
+		//
+		value_t value[ 1 ];
+
+		// Construct a new hash from an optional seed of 64-bit value.
+		//
+		constexpr wy64_hash_t( value_t seed64 = default_seed ) noexcept
+			: value{ seed64 } {}
+
+		// Multiplies the two values and folds the 128-bit product into 64-bits.
+		//
+		__forceinline static constexpr value_t mix( value_t a, value_t b ) noexcept
+		{
+#if defined(__SIZEOF_INT128__)
+			unsigned __int128 r = ( unsigned __int128 ) a * b;
+			return value_t( r ) ^ value_t( r >> 64 );
+#else
+#if defined(_MSC_VER) && defined(_WIN64)
+			if ( !std::is_constant_evaluated() )
+			{
+				value_t hi;
+				value_t lo = _umul128( a, b, &hi );
+				return lo ^ hi;
+			}
+#endif
+
+			value_t ha = a >> 32, la = uint32_t( a );
+			value_t hb = b >> 32, lb = uint32_t( b );
+			value_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+			value_t t = rl + ( rm0 << 32 );
+			value_t lo = t + ( rm1 << 32 );
+			value_t hi = rh + ( rm0 >> 32 ) + ( rm1 >> 32 ) + ( t < rl ) + ( lo < t );
+			return lo ^ hi;
+#endif
+		}
+
+		// Appends the given array of bytes into the hash value, each 64-bit word is mixed
+		// with the current value and the length is mixed with the first word.
+		//
+		template<typename T>
+		constexpr void add_bytes( const T& data ) noexcept
+		{
+			using array_t = std::array<uint8_t, sizeof( T )>;
+
+#ifndef __INTELLISENSE__
+			if ( std::is_constant_evaluated() && !std::is_same_v<array_t, T> )
+			{
+				if constexpr ( Bitcastable<T> )
+					return add_bytes( bit_cast<array_t>( data ) );
+				unreachable();
+			}
+#endif
+
+			const array_t& bytes = ( const array_t& ) data;
+			value_t seed = value[ 0 ] ^ sizeof( T );
+			for ( size_t offset = 0; offset < sizeof( T ); offset += 8 )
+			{
+				// Read the next word, zero padded.
+				//
+				value_t word = 0;
+				size_t count = std::min<size_t>( 8, sizeof( T ) - offset );
+				if ( std::is_constant_evaluated() )
+				{
+					for ( size_t i = 0; i != count; i++ )
+						word |= value_t( bytes[ offset + i ] ) << ( i * 8 );
+				}
+				else
+				{
+					memcpy( &word, &bytes[ offset ], count );
+				}
+
+				// Mix it with the current value.
+				//
+				seed = mix( seed ^ secret[ 0 ], word ^ secret[ 1 ] );
+			}
+			value[ 0 ] = seed;
+		}
+
+		// Implicit conversion to 64-bit values.
+		//
+		constexpr uint64_t as64() const noexcept { return value[ 0 ]; }
+		constexpr operator uint64_t() const noexcept { return as64(); }
+
+		// Conversion to human-readable format.
+		//
+		std::string to_string() const
+		{
+			return format::str( "0x%p", value[ 0 ] );
+		}
+
+		// Basic comparison operators.
+		//
+		constexpr bool operator<( const wy64_hash_t& o ) const noexcept { return value[ 0 ] < o.value[ 0 ]; }
+		constexpr bool operator==( const wy64_hash_t& o ) const noexcept { return value[ 0 ] == o.value[ 0 ]; }
+		constexpr bool operator!=( const wy64_hash_t& o ) const noexcept { return value[ 0 ] != o.value[ 0 ]; }
+	};
+};
+
+// Make it std::hashable.
+//
+namespace std
+{
+	template<>
+	struct hash<vtil::wy64_hash_t>
+	{
+		size_t operator()( const vtil::wy64_hash_t& value ) const { return ( size_t ) value.as64(); }
+	};
+};
\ No newline at end of file
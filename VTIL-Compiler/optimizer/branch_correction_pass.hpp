@@ -41,7 +41,6 @@ namespace vtil::optimizer
 	struct branch_correction_pass : pass_interface<execution_order::parallel>
 	{
 		std::shared_mutex mutex;
-		cached_tracer ctracer = {};
 
 		size_t pass( basic_block* blk, bool xblock = false ) override;
 		size_t xpass( routine* rtn ) override;
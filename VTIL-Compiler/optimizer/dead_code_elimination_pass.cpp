@@ -40,6 +40,10 @@ namespace vtil::optimizer
 
 		std::vector<il_const_iterator> delete_list = {};
 
+		// Use the tracer of the routine so that the traces are shared with the other passes.
+		//
+		routine_tracer& ctrace = blk->owner->context;
+
 		// Acquire a shared lock.
 		//
 		cnd_shared_lock lock( mtx, xblock );
@@ -94,7 +98,13 @@ namespace vtil::optimizer
 			{
 				// Set to nop, will be invalid instruction, but can be atomically assigned.
 				//
+				epoch_t epoch = blk->epoch;
 				( +it )->base = &ins::nop;
+
+				// Results of the instruction are not used so the traces are not affected, 
+				// keep the cached entries of the block if they were up to date before it.
+				//
+				ctrace.revalidate( blk, epoch );
 				delete_list.emplace_back( it );
 			}
 		}
@@ -109,7 +119,8 @@ namespace vtil::optimizer
 		// Purge simplifier cache since block iterators are invalided thus cache may fail,
 		// return deleted instruction count as result.
 		//
-		ctrace.flush( blk );
+		if ( !delete_list.empty() )
+			ctrace.flush( blk );
 		return delete_list.size();
 	}
 };
\ No newline at end of file
@@ -36,7 +36,6 @@ namespace vtil::optimizer
 	//
 	struct dead_code_elimination_pass : pass_interface<execution_order::parallel_df>
 	{
-		cached_tracer ctrace;
 		std::shared_mutex mtx;
 		size_t pass( basic_block* blk, bool xblock = false ) override;
 	};
@@ -166,12 +166,21 @@ namespace vtil::optimizer
 				instruction_buffer.emplace_back( &ins::mov, k, translator << v );
 			}
 
+			// Simplify the memory state in a single batch.
+			//
+			std::vector<symbolic::expression::reference> memory_values;
+			memory_values.reserve( vm.memory_state.size() );
+			for ( auto& [k, v] : vm.memory_state )
+				memory_values.emplace_back( std::move( v ) );
+			symbolic::simplify_expressions( memory_values );
+			for ( auto it = memory_values.begin(); auto& [k, v] : vm.memory_state )
+				v = std::move( *it++ );
+
 			// For each memory state:
-			// -- TODO: Simplify memory state, merge if simplifies, discard if left as is.
+			// -- TODO: Merge if simplifies, discard if left as is.
 			//
 			for ( auto& [k, v] : vm.memory_state )
 			{
-				v.simplify();
 				symbolic::expression v0 = symbolic::MEMORY( k, v.size() );
 
 				// If value is unchanged, skip.
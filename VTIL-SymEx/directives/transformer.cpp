@@ -36,7 +36,7 @@ namespace vtil::symbolic
 
 	// Translates the given directive into an expression (of size given) using the symbol table.
 	//
-	expression::reference translate( const symbol_table_t& sym, const instance* dir, bitcnt_t bit_cnt )
+	expression::reference translate( const symbol_table_t& sym, const instance* dir, bitcnt_t bit_cnt, bool relaxed )
 	{
 		using namespace logger;
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
@@ -64,9 +64,9 @@ namespace vtil::symbolic
 				if ( dir->op == math::operator_id::ucast ||
 					 dir->op == math::operator_id::cast )
 				{
-					auto lhs = translate( sym, dir->lhs, 0 );
+					auto lhs = translate( sym, dir->lhs, 0, relaxed );
 					if ( !lhs )	return {};
-					auto rhs = translate( sym, dir->rhs, bit_cnt );
+					auto rhs = translate( sym, dir->rhs, bit_cnt, relaxed );
 					if ( !rhs ) return {};
 
 					if ( auto sz = rhs->get<bitcnt_t>() )
@@ -91,7 +91,7 @@ namespace vtil::symbolic
 						std::swap( tx[ 0 ], tx[ 1 ] );
 
 					for( auto& [out, dir] : tx )
-						if ( !( *out = translate( sym, dir, bit_cnt ) ) )
+						if ( !( *out = translate( sym, dir, bit_cnt, relaxed ) ) )
 							return {};
 
 					return expression::make( std::move( lhs ), dir->op, std::move( rhs ) );
@@ -100,7 +100,7 @@ namespace vtil::symbolic
 				//
 				else
 				{
-					auto rhs = translate( sym, dir->rhs, bit_cnt );
+					auto rhs = translate( sym, dir->rhs, bit_cnt, relaxed );
 					if ( !rhs ) return {};
 					return expression::make( dir->op, std::move( rhs ) );
 				}
@@ -116,12 +116,17 @@ namespace vtil::symbolic
 			{
 				// If expression translates successfully:
 				//
-				if ( auto e1 = translate( sym, dir->rhs, bit_cnt ) )
+				if ( auto e1 = translate( sym, dir->rhs, bit_cnt, relaxed ) )
 				{
 					// Return only if it was successful.
 					//
 					if ( !e1->simplify_hint && simplify_expression( e1, false, false ) )
 						return e1;
+
+					// If relaxed, accept the expression as is.
+					//
+					if ( relaxed )
+						return e1;
 				}
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
 				log<CON_RED>( "Rejected, does not simplify.\n", *dir->rhs );
@@ -132,7 +137,7 @@ namespace vtil::symbolic
 			{
 				// Translate right hand side.
 				//
-				if ( auto e1 = translate( sym, dir->rhs, bit_cnt ) )
+				if ( auto e1 = translate( sym, dir->rhs, bit_cnt, relaxed ) )
 				{
 					// Simplify the expression.
 					//
@@ -150,7 +155,7 @@ namespace vtil::symbolic
 
 				// Unpack first expression, if translated successfully, return it as is.
 				//
-				if ( auto e1 = translate( sym, dir->lhs, bit_cnt ) )
+				if ( auto e1 = translate( sym, dir->lhs, bit_cnt, relaxed ) )
 					return e1;
 
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
@@ -159,7 +164,7 @@ namespace vtil::symbolic
 
 				// Unpack second expression, if translated successfully, return it as is.
 				//
-				if ( auto e2 = translate( sym, dir->rhs, bit_cnt ) )
+				if ( auto e2 = translate( sym, dir->rhs, bit_cnt, relaxed ) )
 					return e2;
 
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
@@ -187,13 +192,13 @@ namespace vtil::symbolic
 				// Continue the translation from the right hand side.
 				//
 				condition_status.reset();
-				return translate( sym, dir->rhs, bit_cnt );
+				return translate( sym, dir->rhs, bit_cnt, relaxed );
 			}
 			case directive_op_desc::mask_unknown:
 			{
 				// Translate right hand side.
 				//
-				if ( auto exp = translate( sym, dir->rhs, bit_cnt ) )
+				if ( auto exp = translate( sym, dir->rhs, bit_cnt, relaxed ) )
 				{
 					// Return the unknown mask.
 					//
@@ -206,7 +211,7 @@ namespace vtil::symbolic
 			{
 				// Translate right hand side.
 				//
-				if ( auto exp = translate( sym, dir->rhs, bit_cnt ) )
+				if ( auto exp = translate( sym, dir->rhs, bit_cnt, relaxed ) )
 				{
 					// Return the unknown mask.
 					//
@@ -218,7 +223,7 @@ namespace vtil::symbolic
 			{
 				// Translate right hand side.
 				//
-				if ( auto exp = translate( sym, dir->rhs, bit_cnt ) )
+				if ( auto exp = translate( sym, dir->rhs, bit_cnt, relaxed ) )
 				{
 					// Return the unknown mask.
 					//
@@ -240,7 +245,7 @@ namespace vtil::symbolic
 
 				// Continue the translation from the right hand side.
 				//
-				return translate( sym, dir->rhs, bit_cnt );
+				return translate( sym, dir->rhs, bit_cnt, relaxed );
 			}
 			default:
 				unreachable();
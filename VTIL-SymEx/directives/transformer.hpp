@@ -34,10 +34,12 @@
 namespace vtil::symbolic
 {
 	// Translates the given directive into an expression (of size given) using the symbol table.
+	// If relaxed, simplification directives do not require the expression to simplify.
 	//
 	expression::reference translate( const directive::symbol_table_t& sym,
                                      const directive::instance* dir,
-                                     bitcnt_t bit_cnt );
+                                     bitcnt_t bit_cnt,
+                                     bool relaxed = false );
 
 	// Attempts to transform the expression in form A to form B as indicated by the directives, 
 	// and returns the first instance that matches query.
@@ -0,0 +1,176 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#include "compiled_expression.hpp"
+#include <unordered_map>
+
+// [Configuration]
+// Determine the number of assignments evaluated together in a batch and the number of 
+// registers that can be held on the stack for a single evaluation.
+//
+#ifndef VTIL_SYMEX_COMPILED_BATCH_LANES
+	#define VTIL_SYMEX_COMPILED_BATCH_LANES 64
+#endif
+#ifndef VTIL_SYMEX_COMPILED_STACK_REGISTERS
+	#define VTIL_SYMEX_COMPILED_STACK_REGISTERS 256
+#endif
+
+namespace vtil::symbolic
+{
+	// Compiles the expression given.
+	//
+	compiled_expression::compiled_expression( const expression& exp )
+	{
+		// Map each structurally identical subtree to a single register.
+		//
+		struct node_hasher { size_t operator()( const expression* e ) const noexcept { return e->hash(); } };
+		struct node_equal { bool operator()( const expression* a, const expression* b ) const noexcept { return a->is_identical( *b ); } };
+		std::unordered_map<const expression*, uint32_t, node_hasher, node_equal> visited;
+
+		auto lower = [ & ] ( auto&& self, const expression& e ) -> uint32_t
+		{
+			if ( auto it = visited.find( &e ); it != visited.end() )
+				return it->second;
+
+			uint32_t reg;
+
+			// If value is known, load it as a constant.
+			//
+			if ( e.value.is_known() )
+			{
+				reg = ( uint32_t ) registers.size();
+				registers.emplace_back( e.value.known_one() );
+			}
+			// If variable, allocate an input register.
+			//
+			else if ( e.is_variable() )
+			{
+				reg = ( uint32_t ) registers.size();
+				registers.emplace_back( 0 );
+				variables.emplace_back( e.uid.get() );
+				variable_registers.emplace_back( reg );
+				variable_masks.emplace_back( e.value.value_mask() );
+			}
+			// If operation, lower the operands and emit the instruction.
+			//
+			else
+			{
+				fassert( e.is_expression() );
+				instruction ins = { e.op, 0, e.rhs->size(), 0, 0, 0 };
+				if ( e.lhs )
+				{
+					ins.lhs = self( self, *e.lhs );
+					ins.lhs_size = e.lhs->size();
+				}
+				ins.rhs = self( self, *e.rhs );
+				ins.dst = reg = ( uint32_t ) registers.size();
+				registers.emplace_back( 0 );
+				instructions.emplace_back( ins );
+			}
+
+			visited.emplace( &e, reg );
+			return reg;
+		};
+		result = lower( lower, exp );
+		result_size = exp.size();
+	}
+
+	// Evaluates the expression for a single assignment of the variables.
+	//
+	uint64_t compiled_expression::evaluate( std::span<const uint64_t> values ) const
+	{
+		fassert( values.size() == variables.size() );
+
+		// Copy the register file to the stack if it fits.
+		//
+		uint64_t stack_registers[ VTIL_SYMEX_COMPILED_STACK_REGISTERS ];
+		std::vector<uint64_t> heap_registers;
+		uint64_t* regs = stack_registers;
+		if ( registers.size() <= std::size( stack_registers ) )
+			std::copy( registers.begin(), registers.end(), regs );
+		else
+			regs = ( heap_registers = registers ).data();
+
+		// Load the variables.
+		//
+		for ( size_t n = 0; n != values.size(); n++ )
+			regs[ variable_registers[ n ] ] = values[ n ] & variable_masks[ n ];
+
+		// Execute each instruction.
+		//
+		for ( const instruction& ins : instructions )
+			regs[ ins.dst ] = math::evaluate( ins.op, ins.lhs_size, regs[ ins.lhs ], ins.rhs_size, regs[ ins.rhs ] ).first;
+		return regs[ result ];
+	}
+
+	// Evaluates the expression for [out.size()] assignments of the variables laid out
+	// consecutively in [values].
+	//
+	void compiled_expression::evaluate( std::span<const uint64_t> values, std::span<uint64_t> out ) const
+	{
+		constexpr size_t lanes = VTIL_SYMEX_COMPILED_BATCH_LANES;
+		fassert( values.size() == variables.size() * out.size() );
+
+		// Allocate a register file with a row of lanes per register and load the constants.
+		//
+		std::vector<uint64_t> regs( registers.size() * lanes );
+		for ( size_t r = 0; r != registers.size(); r++ )
+			std::fill_n( &regs[ r * lanes ], lanes, registers[ r ] );
+
+		// For each chunk of assignments:
+		//
+		for ( size_t base = 0; base < out.size(); base += lanes )
+		{
+			size_t count = std::min( lanes, out.size() - base );
+
+			// Transpose the variables into their rows.
+			//
+			for ( size_t n = 0; n != variables.size(); n++ )
+			{
+				uint64_t* row = &regs[ variable_registers[ n ] * lanes ];
+				for ( size_t i = 0; i != count; i++ )
+					row[ i ] = values[ ( base + i ) * variables.size() + n ] & variable_masks[ n ];
+			}
+
+			// Execute each instruction over the lanes.
+			//
+			for ( const instruction& ins : instructions )
+			{
+				math::evaluate_lanes( 
+					ins.op, 
+					ins.lhs_size, ins.lhs_size ? &regs[ ins.lhs * lanes ] : nullptr,
+					ins.rhs_size, &regs[ ins.rhs * lanes ], 
+					&regs[ ins.dst * lanes ], count 
+				);
+			}
+
+			// Write the results.
+			//
+			std::copy_n( &regs[ result * lanes ], count, &out[ base ] );
+		}
+	}
+};
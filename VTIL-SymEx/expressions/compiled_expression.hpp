@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#pragma once
+#include <vector>
+#include <span>
+#include "expression.hpp"
+
+namespace vtil::symbolic
+{
+	// Expression lowered into a linear post-order instruction stream over a flat register
+	// file, used to evaluate the same expression for many concrete variable assignments
+	// without walking the tree.
+	//
+	struct compiled_expression
+	{
+		// Single operation, reads the operand registers and writes the destination register.
+		// Unary operations read the zero register as their left hand side.
+		//
+		struct instruction
+		{
+			math::operator_id op;
+			bitcnt_t lhs_size;
+			bitcnt_t rhs_size;
+			uint32_t dst;
+			uint32_t lhs;
+			uint32_t rhs;
+		};
+
+		// Variables of the expression, values are passed in this order. Identifiers used with
+		// different sizes are listed once per size.
+		//
+		std::vector<unique_identifier> variables;
+
+		// Register and value mask of each variable.
+		//
+		std::vector<uint32_t> variable_registers;
+		std::vector<uint64_t> variable_masks;
+
+		// Initial state of the register file with the constants loaded, register zero is always zero.
+		//
+		std::vector<uint64_t> registers = { 0 };
+
+		// Instructions in post-order.
+		//
+		std::vector<instruction> instructions;
+
+		// Register holding the result and the size of the result.
+		//
+		uint32_t result = 0;
+		bitcnt_t result_size = 0;
+
+		// Compiles the expression given.
+		//
+		compiled_expression() = default;
+		compiled_expression( const expression& exp );
+		compiled_expression( const expression::reference& exp ) : compiled_expression( *exp ) {}
+
+		// Evaluates the expression for a single assignment of the variables.
+		//
+		uint64_t evaluate( std::span<const uint64_t> values ) const;
+
+		// Evaluates the expression for [out.size()] assignments of the variables laid out
+		// consecutively in [values].
+		//
+		void evaluate( std::span<const uint64_t> values, std::span<uint64_t> out ) const;
+
+		// Evaluates the expression resolving the variables through the callback passed.
+		//
+		template<typename T>
+		uint64_t evaluate( T&& lookup ) const
+		{
+			std::vector<uint64_t> values( variables.size() );
+			for ( size_t n = 0; n != variables.size(); n++ )
+				values[ n ] = lookup( variables[ n ] );
+			return evaluate( values );
+		}
+	};
+};
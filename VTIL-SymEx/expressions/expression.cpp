@@ -58,9 +58,9 @@ namespace vtil::symbolic
 		std::set<unique_identifier> tmp;
 		if ( !visited ) visited = &tmp;
 
-		if ( is_variable() && visited->find( uid ) == visited->end() )
+		if ( is_variable() && visited->find( uid.get() ) == visited->end() )
 		{
-			visited->insert( uid );
+			visited->insert( uid.get() );
 			return 1;
 		}
 		else
@@ -396,6 +396,14 @@ namespace vtil::symbolic
 	//
 	expression& expression::update( bool auto_simplify )
 	{
+		// Modified nodes can no longer be the canonical instance.
+		//
+		is_interned.reset();
+
+		// Invalidate the x values.
+		//
+		xvalue_lanes.reset();
+
 		// Propagate lazyness.
 		//
 		if ( ( lhs && lhs->is_lazy ) ||
@@ -719,6 +727,10 @@ namespace vtil::symbolic
 	{
 		if ( &self == &other ) return true;
 
+		// If both are canonical instances of the interning table, they cannot be identical.
+		//
+		if ( self.is_interned && other.is_interned ) return false;
+
 		auto report_hash_collision = [ & ] ()
 		{
 #ifdef _DEBUG
@@ -821,30 +833,36 @@ namespace vtil::symbolic
 	// the UID relation table, otherwise returns nullopt.
 	//
 	using fast_uid_relation_table = stack_vector<std::pair<expression::weak_reference, expression::weak_reference>>;
-	static bool match_to_impl( const expression::reference& a, const expression::reference& b, fast_uid_relation_table* tbl, bool same_depth )
+
+	// Pushes the identity relation of every variable in the expression into the table, fails if any of
+	// them is already mapped to a different variable. Only the first [num_checked] entries can conflict
+	// since everything pushed after them by this routine is an identity relation, which keeps the cost
+	// linear in the size of the tree rather than quadratic for deep identical subtrees.
+	//
+	static bool push_identity_relations( const expression::reference& exp, fast_uid_relation_table* tbl, size_t num_checked )
 	{
-		// If identical, try pushing all variables into the table.
-		//
-		if ( a->is_identical( *b ) )
+		if ( exp->is_variable() )
 		{
-			bool success = true;
-			a.transform( [ & ] ( symbolic::expression_delegate& exp )
+			for ( size_t n = 0; n != num_checked; n++ )
 			{
-				if ( !success || !exp->is_variable() ) 
-					return;
-				for ( auto& [src, dst] : *tbl )
-				{
-					if ( exp->uid == src->uid && 
-						 exp->uid != dst->uid )
-					{
-						success = false;
-						return;
-					}
-				}
-				tbl->emplace_back( exp.ref, exp.ref );
-			}, true, false );
-			return success;
+				auto& [src, dst] = ( *tbl )[ n ];
+				if ( exp->uid == src->uid && exp->uid != dst->uid )
+					return false;
+			}
+			tbl->emplace_back( exp, exp );
+			return true;
 		}
+		return ( !exp->lhs || push_identity_relations( exp->lhs, tbl, num_checked ) ) &&
+			   ( !exp->rhs || push_identity_relations( exp->rhs, tbl, num_checked ) );
+	}
+
+	static bool match_to_impl( const expression::reference& a, const expression::reference& b, fast_uid_relation_table* tbl, bool same_depth )
+	{
+		// If identical, try pushing all variables into the table, the tree is walked in place 
+		// rather than through ::transform as nothing is modified.
+		//
+		if ( a->is_identical( *b ) )
+			return push_identity_relations( a, tbl, tbl->size() );
 
 		// Check if properties match.
 		//
@@ -984,11 +1002,13 @@ namespace vtil::symbolic
 	}
 	expression_reference& expression_reference::simplify( bool prettify, bool* out )
 	{
-		bool simplified;
+		// Simplifier interns the result itself, if skipped, intern by the same rules.
+		//
+		bool simplified = false;
 		if ( is_valid() && ( prettify || !get()->simplify_hint ) )
 			simplified = simplify_expression( *this, prettify );
 		else
-			simplified = false;
+			intern_simplified( *this );
 		if ( out ) *out = simplified;
 		return *this;
 	}
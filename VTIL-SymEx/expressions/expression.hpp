@@ -36,7 +36,7 @@
 // Determine the number of x value keys we use to estimate values.
 //
 #ifndef VTIL_SYMEX_XVAL_KEYS
-	#define VTIL_SYMEX_XVAL_KEYS 4
+	#define VTIL_SYMEX_XVAL_KEYS 16
 #endif
 
 // Allow expression::reference to be used with expression type directly as operable.
@@ -73,6 +73,110 @@ namespace vtil::symbolic
 		expression* operator+() { dirty = 1; return ref.own(); }
 	};
 
+	// Simplifier hint of an expression, atomic since results published to the shared simplifier cache
+	// are marked by several threads at once. Unlike the flag below copies do propagate it, and stores
+	// that would not change the value are skipped so that shared nodes are not written to.
+	//
+	struct hint_flag
+	{
+		std::atomic<bool> value = false;
+
+		hint_flag() = default;
+		hint_flag( bool v ) : value( v ) {}
+		hint_flag( const hint_flag& o ) : value( ( bool ) o ) {}
+		hint_flag& operator=( const hint_flag& o ) { return operator=( ( bool ) o ); }
+		hint_flag& operator=( bool v )
+		{
+			if ( value.load( std::memory_order::relaxed ) != v )
+				value.store( v, std::memory_order::relaxed );
+			return *this;
+		}
+		operator bool() const { return value.load( std::memory_order::relaxed ); }
+	};
+
+	// Flag marking the canonical instances held by the interning table, atomic since it is set on
+	// nodes that may already be shared between threads. Copies and assignments never propagate it.
+	//
+	struct intern_flag
+	{
+		mutable std::atomic<bool> value = false;
+
+		intern_flag() = default;
+		intern_flag( const intern_flag& ) {}
+		intern_flag& operator=( const intern_flag& ) { reset(); return *this; }
+
+		void set() const { value.store( true, std::memory_order::relaxed ); }
+		void reset() const { value.store( false, std::memory_order::relaxed ); }
+		explicit operator bool() const { return value.load( std::memory_order::relaxed ); }
+	};
+
+	// Lazily calculated x values of an expression, atomic since they are calculated on nodes that
+	// may already be shared between threads. Copies and assignments never propagate them.
+	//
+	struct xvalue_cache
+	{
+		mutable std::atomic<uint64_t*> lanes = nullptr;
+
+		xvalue_cache() = default;
+		xvalue_cache( const xvalue_cache& ) {}
+		xvalue_cache& operator=( const xvalue_cache& ) { reset(); return *this; }
+		~xvalue_cache() { reset(); }
+
+		// Returns the cached lanes if calculated, null otherwise.
+		//
+		const uint64_t* get() const { return lanes.load( std::memory_order::acquire ); }
+
+		// Publishes the calculated lanes, if another thread raced us returns its lanes instead.
+		//
+		const uint64_t* set( std::unique_ptr<uint64_t[]> values ) const
+		{
+			uint64_t* expected = nullptr;
+			if ( lanes.compare_exchange_strong( expected, values.get(), std::memory_order::acq_rel ) )
+				return values.release();
+			return expected;
+		}
+
+		// Resets the cache, must only be called on nodes that are not shared.
+		//
+		void reset() const { delete[] lanes.exchange( nullptr, std::memory_order::relaxed ); }
+	};
+
+	// Unique identifier of a symbolic variable held out of line, since it is several times the size
+	// of the rest of the node and only used by variables. Copies share the identifier, it is copied
+	// on write.
+	//
+	struct identifier_reference
+	{
+		shared_reference<unique_identifier> ref = {};
+
+		identifier_reference() = default;
+		identifier_reference( const unique_identifier& uid ) : ref( uid ) {}
+
+		// Returns the identifier, or an invalid one if null.
+		//
+		const unique_identifier& get() const
+		{
+			static const unique_identifier null_identifier = {};
+			return ref ? *ref : null_identifier;
+		}
+		operator const unique_identifier&() const { return get(); }
+
+		// Wrappers around the unique identifier interface.
+		//
+		template<typename T> const T& get() const { return ref->get<T>(); }
+		template<typename T> T& get() { return ref.own()->get<T>(); }
+		template<typename T> bool is() const { return ref && ref->is<T>(); }
+		hash_t hash() const { return ref ? ref->hash() : hash_t{}; }
+		const std::string& to_string() const { return get().to_string(); }
+		explicit operator bool() const { return ref && ( bool ) *ref; }
+
+		// Comparison operators, identical references skip the deep comparison.
+		//
+		bool operator==( const identifier_reference& o ) const { return ref == o.ref || get() == o.get(); }
+		bool operator!=( const identifier_reference& o ) const { return !operator==( o ); }
+		bool operator<( const identifier_reference& o ) const { return get() < o.get(); }
+	};
+
 	// Expression references.
 	//
 	struct expression_reference : shared_reference<expression>
@@ -184,43 +288,58 @@ namespace vtil::symbolic
 		using weak_reference =     weak_reference<expression>;
 		using uid_relation_table = std::vector<std::pair<expression::weak_reference, expression::weak_reference>>;
 
-		// If symbolic variable, the unique identifier that it maps to.
+		// Fields are ordered by access frequency, everything the comparison and matching routines touch
+		// is packed right after the value so that it shares the first cache line of the node.
 		//
-		unique_identifier uid = {};
-
-		// If operation, identifier of the operator and the sub-expressions for the operands.
+		// If operation, identifier of the operator.
 		//
 		math::operator_id op = math::operator_id::invalid;
-		reference lhs = {};
-		reference rhs = {};
 
-		// An arbitrarily defined complexity value that is used as an inverse reward function in simplification.
+		// Whether expression passed the simplifier already or not, note that this is a hint and there may 
+		// be cases where it already has passed it and this flag was not set. Albeit those cases will most 
+		// likely not cause performance issues due to the caching system.
 		//
-		double complexity = 0;
+		mutable hint_flag simplify_hint = {};
 
-		// Depth of the current expression.
-		// - If constant or symbolic variable, = 0
-		// - Otherwise                         = max(operands...) + 1
+		// Disables implicit auto-simplification for the expression if is set.
 		//
-		size_t depth = 0;
+		bool is_lazy = false;
+
+		// Set if this node is the canonical instance of the interning table, in which case any 
+		// other interned node is known to be non-identical without having to walk the tree.
+		//
+		intern_flag is_interned = {};
 
 		// Hash of the expression used by the simplifier cache.
 		//
 		hash_t hash_value = {};
 
+		// If operation, the sub-expressions for the operands.
+		//
+		reference lhs = {};
+		reference rhs = {};
+
+		// If symbolic variable, the unique identifier that it maps to.
+		//
+		identifier_reference uid = {};
+
 		// Signature of the expression.
 		//
 		expression_signature signature = {};
 
-		// Whether expression passed the simplifier already or not, note that this is a hint and there may 
-		// be cases where it already has passed it and this flag was not set. Albeit those cases will most 
-		// likely not cause performance issues due to the caching system.
+		// An arbitrarily defined complexity value that is used as an inverse reward function in simplification.
 		//
-		mutable bool simplify_hint = false;
+		double complexity = 0;
 
-		// Disables implicit auto-simplification for the expression if is set.
+		// Depth of the current expression.
+		// - If constant or symbolic variable, = 0
+		// - Otherwise                         = max(operands...) + 1
 		//
-		bool is_lazy = false;
+		size_t depth = 0;
+
+		// Cached x values of the expression with the default key count.
+		//
+		xvalue_cache xvalue_lanes = {};
 
 		// Default constructor and copy/move.
 		//
@@ -237,7 +356,7 @@ namespace vtil::symbolic
 
 		// Constructor for symbolic variables.
 		//
-		expression( const unique_identifier& uid, bitcnt_t bit_count ) : operable(), uid( uid ), simplify_hint( true ) { value = math::bit_vector( bit_count ); update( false ); }
+		expression( const unique_identifier& uid, bitcnt_t bit_count ) : operable(), simplify_hint( true ), uid( uid ) { value = math::bit_vector( bit_count ); update( false ); }
 
 		// Constructor for expressions.
 		//
@@ -277,7 +396,7 @@ namespace vtil::symbolic
 
 		// Helpers to determine the type of the expression.
 		//
-		bool is_variable() const { return uid; }
+		bool is_variable() const { return ( bool ) uid; }
 		bool is_expression() const { return op != math::operator_id::invalid; }
 		bool is_unary() const { return is_expression() && get_op_desc().operand_count == 1; }
 		bool is_binary() const { return is_expression() && get_op_desc().operand_count == 2; }
@@ -338,37 +457,40 @@ namespace vtil::symbolic
 		//
 		bool contains( const expression& o ) const;
 
-		// Calculates the x values.
+		// Calculates the x values into [out] lane by lane, the lanes of the operands are taken from their
+		// caches if the default key count is used.
 		//
 		template<size_t N = VTIL_SYMEX_XVAL_KEYS>
-		std::array<uint64_t, N> xvalues() const
+		void calculate_xvalues( uint64_t* out ) const
 		{
-			std::array<uint64_t, N> result;
-		
 			// If binary operation:
 			//
 			if ( lhs )
 			{
-				// Determine rhs mask.
+				// Evalute based on lhs's and rhs's xvalues.
+				//
+				auto xlhs = lhs->template xvalues<N>();
+				auto xrhs = rhs->template xvalues<N>();
+
+				// Mask rhs if shift count.
 				//
-				uint64_t rhs_mask;
 				switch ( op )
 				{
 					case math::operator_id::shift_right:
 					case math::operator_id::shift_left:
 					case math::operator_id::rotate_right:
 					case math::operator_id::rotate_left:
-					case math::operator_id::bit_test:     rhs_mask = rhs->is_variable() 
-																	   ? lhs->size() - 1 : ~0ull; break;
-					default:                              rhs_mask = ~0ull;                       break;
+					case math::operator_id::bit_test:
+						if ( rhs->is_variable() )
+						{
+							for ( auto& v : xrhs )
+								v &= lhs->size() - 1;
+						}
+						break;
+					default:
+						break;
 				}
-
-				// Evalute based on lhs's and rhs's xvalues.
-				//
-				auto xlhs = lhs->template xvalues<N>();
-				auto xrhs = rhs->template xvalues<N>();
-				for ( auto [out, vlhs, vrhs] : zip( result, xlhs, xrhs ) )
-					out = math::evaluate( op, lhs->size(), vlhs, rhs->size(), vrhs & rhs_mask ).first;
+				math::evaluate_lanes( op, lhs->size(), xlhs.data(), rhs->size(), xrhs.data(), out, N );
 			}
 			// If unary operation:
 			//
@@ -377,8 +499,7 @@ namespace vtil::symbolic
 				// Evalute based on rhs's xvalues.
 				//
 				auto xrhs = rhs->template xvalues<N>();
-				for ( auto [out, vrhs] : zip( result, xrhs ) )
-					out = math::evaluate( op, 0, 0, rhs->size(), vrhs ).first;
+				math::evaluate_lanes( op, 0, nullptr, rhs->size(), xrhs.data(), out, N );
 			}
 			// If constant:
 			//
@@ -386,7 +507,7 @@ namespace vtil::symbolic
 			{
 				// All x values are equivalent to the actual value.
 				//
-				result.fill( *value.get() );
+				std::fill_n( out, N, *value.get() );
 			}
 			// If variable:
 			//
@@ -396,22 +517,40 @@ namespace vtil::symbolic
 
 				// Generate x values based on the hash.
 				//
-				for ( auto [out, key, idx] : zip( result, keys, iindices ) )
+				out[ 0 ] = ( hash_value & 63 ) & value.value_mask();
+				for ( size_t idx = 1; idx != N; idx++ )
+					out[ idx ] = ( hash_value ^ keys[ idx ] ) & value.value_mask();
+			}
+			else
+			{
+				unreachable();
+			}
+		}
+
+		// Calculates the x values, the default key count is cached in the node.
+		//
+		template<size_t N = VTIL_SYMEX_XVAL_KEYS>
+		std::array<uint64_t, N> xvalues() const
+		{
+			std::array<uint64_t, N> result;
+			if constexpr ( N == VTIL_SYMEX_XVAL_KEYS )
+			{
+				const uint64_t* lanes = xvalue_lanes.get();
+				if ( !lanes )
 				{
-					if ( idx != 0 )
-						out = ( hash_value ^ key ) & value.value_mask();
-					else
-						out = ( hash_value & 63 ) & value.value_mask();
+					std::unique_ptr<uint64_t[]> values{ new uint64_t[ N ] };
+					calculate_xvalues<N>( values.get() );
+					lanes = xvalue_lanes.set( std::move( values ) );
 				}
+				std::copy_n( lanes, N, result.begin() );
 			}
 			else
 			{
-				unreachable();
+				calculate_xvalues<N>( result.data() );
 			}
 			return result;
 		}
 
-
 		// Evaluates the expression invoking the callback passed for unknown variables,
 		// this avoids copying of the entire tree and any simplifier calls so is preferred
 		// over *transform(...).get().
@@ -430,7 +569,7 @@ namespace vtil::symbolic
 			{
 				// If lookup helper passed and succesfully finds the value, use as is.
 				//
-				if ( std::optional<uint64_t> res = lookup( uid ) )
+				if ( std::optional<uint64_t> res = lookup( uid.get() ) )
 					return { *res, size() };
 			
 				// Otherwise return unknown.
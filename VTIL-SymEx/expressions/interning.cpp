@@ -0,0 +1,141 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#include "interning.hpp"
+#include <shared_mutex>
+#include <unordered_set>
+
+namespace vtil::symbolic
+{
+	// Single shard of the interning table, canonical instances are kept alive by the set itself.
+	//
+	struct interning_shard
+	{
+		using set_type = std::unordered_set<expression::reference, expression::reference::hasher, expression::reference::if_identical>;
+
+		std::shared_mutex mtx;
+		set_type set;
+	};
+	static constexpr size_t interning_shard_count = VTIL_SYMEX_INTERN_SHARD_COUNT;
+
+	// Table is intentionally leaked to avoid destruction order issues with the object pool.
+	//
+	static interning_shard* get_interning_shards()
+	{
+		static interning_shard* shards = new interning_shard[ interning_shard_count ];
+		return shards;
+	}
+	static interning_shard& get_interning_shard( hash_t hash )
+	{
+		return get_interning_shards()[ hash.as64() % interning_shard_count ];
+	}
+	static std::atomic<bool> interning_enabled = { VTIL_SYMEX_INTERN_BY_DEFAULT };
+
+	// Enables or disables the interning of simplifier results, returns the previous state.
+	//
+	bool set_interning( bool enabled ) { return interning_enabled.exchange( enabled && VTIL_SHARED_REFERENCE_ATOMIC ); }
+	bool is_interning_enabled() { return interning_enabled.load( std::memory_order::relaxed ); }
+
+	// Replaces the expression and each of its operands with the canonical instance.
+	//
+	expression::reference& intern( expression::reference& ref )
+	{
+		// Skip if null, already canonical or still subject to modification.
+		//
+		if ( !ref || ref->is_interned || ref->is_lazy || !ref->simplify_hint )
+			return ref;
+
+		// Temporaries must be converted into owning references before they can be stored.
+		//
+		if ( ref.is_temporary() )
+			ref.own();
+
+		// Intern the operands first so that the comparisons in the table resolve by pointer, 
+		// the node is only copied if any of the operands was replaced.
+		//
+		for ( auto operand : { &expression::lhs, &expression::rhs } )
+		{
+			const expression::reference& src = ref.get()->*operand;
+			if ( !src || src->is_interned )
+				continue;
+
+			expression::reference canonical = src;
+			if ( intern( canonical ).get() != src.get() )
+				( +ref )->*operand = std::move( canonical );
+		}
+
+		// Try finding an existing instance under a shared lock first.
+		//
+		auto& shard = get_interning_shard( ref->hash() );
+		{
+			std::shared_lock _g{ shard.mtx };
+			if ( auto it = shard.set.find( ref ); it != shard.set.end() )
+				return ref = *it;
+		}
+
+		// Insert it otherwise, if someone else raced us, the existing instance will be used.
+		//
+		std::unique_lock _g{ shard.mtx };
+		auto [it, inserted] = shard.set.insert( ref );
+		if ( inserted )
+			it->get()->is_interned.set();
+		return ref = *it;
+	}
+	expression::reference intern( const expression::reference& ref )
+	{
+		expression::reference copy = ref;
+		return std::move( intern( copy ) );
+	}
+
+	// Releases all of the canonical instances.
+	//
+	void purge_interning_table()
+	{
+		for ( size_t n = 0; n != interning_shard_count; n++ )
+		{
+			auto& shard = get_interning_shards()[ n ];
+			std::unique_lock _g{ shard.mtx };
+			for ( auto& ref : shard.set )
+				ref->is_interned.reset();
+			shard.set.clear();
+		}
+	}
+
+	// Returns the number of canonical instances in the table.
+	//
+	size_t interning_table_size()
+	{
+		size_t n = 0;
+		for ( size_t i = 0; i != interning_shard_count; i++ )
+		{
+			auto& shard = get_interning_shards()[ i ];
+			std::shared_lock _g{ shard.mtx };
+			n += shard.set.size();
+		}
+		return n;
+	}
+};
@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#pragma once
+#include "expression.hpp"
+
+// [Configuration]
+// Determine whether expressions are interned by default and the number of shards the 
+// interning table is split into to reduce lock contention between threads.
+//
+#ifndef VTIL_SYMEX_INTERN_BY_DEFAULT
+	#define VTIL_SYMEX_INTERN_BY_DEFAULT false
+#endif
+#ifndef VTIL_SYMEX_INTERN_SHARD_COUNT
+	#define VTIL_SYMEX_INTERN_SHARD_COUNT 64
+#endif
+static_assert( VTIL_SHARED_REFERENCE_ATOMIC || !VTIL_SYMEX_INTERN_BY_DEFAULT, "Thread-confined references cannot be interned." );
+
+namespace vtil::symbolic
+{
+	// Enables or disables the interning of simplifier results, returns the previous state. The
+	// table is shared between threads, so it cannot be enabled if references are thread-confined.
+	//
+	bool set_interning( bool enabled );
+	bool is_interning_enabled();
+
+	// Replaces the expression and each of its operands with the canonical instance of the structurally
+	// identical expression, inserting it into the table if none exists. Lazy and non-simplified nodes
+	// are left as is since they are still subject to modification.
+	//
+	expression::reference& intern( expression::reference& ref );
+	[[nodiscard]] expression::reference intern( const expression::reference& ref );
+
+	// Releases all of the canonical instances, expressions that are still referenced stay valid but 
+	// lose their canonical state.
+	//
+	void purge_interning_table();
+
+	// Returns the number of canonical instances in the table.
+	//
+	size_t interning_table_size();
+};
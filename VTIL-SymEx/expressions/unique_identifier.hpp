@@ -34,6 +34,8 @@
 
 namespace vtil::symbolic
 {
+	struct identifier_reference;
+
 	// Unique identifier type to be used within symbolic expression context.
 	//
 	struct unique_identifier
@@ -90,8 +92,8 @@ namespace vtil::symbolic
 		// Construct from any other type.
 		//
 		template<typename T, typename hasher_t = std::hash<T>,
-			// Must not be an array or [const unique_identifier&].
-			std::enable_if_t<!std::is_same_v<T, unique_identifier> && !std::extent_v<T>, int> = 0>
+			// Must not be an array, [const unique_identifier&] or a reference to one.
+			std::enable_if_t<!std::is_same_v<T, unique_identifier> && !std::is_same_v<T, identifier_reference> && !std::extent_v<T>, int> = 0>
 			unique_identifier( const T& v, std::string&& name = "" )
 		{
 			// If name is provided, redirect string_cast to it.
@@ -145,6 +147,10 @@ namespace vtil::symbolic
 		template<typename T> const T& get() const { return value.get<T>(); }
 		template<typename T> T& get() { return value.get<T>(); }
 
+		// Checks whether the value stored is of the given type.
+		//
+		template<typename T> bool is() const { return value.is<T>(); }
+
 		// Returns the cached hash value to abide the standard vtil::hashable.
 		//
 		hash_t hash() const { return hash_value; }
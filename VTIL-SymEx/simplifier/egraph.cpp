@@ -0,0 +1,540 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#include "egraph.hpp"
+#include "simplifier.hpp"
+#include "directives.hpp"
+#include "boolean_directives.hpp"
+#include "../directives/transformer.hpp"
+#include <vtil/io>
+#include <vtil/utility>
+#include <unordered_map>
+#include <bitset>
+
+namespace vtil::symbolic
+{
+	using class_id = uint32_t;
+	static constexpr class_id invalid_class = ~0u;
+
+	// Directives used for saturation, bucketed by the operator of the source.
+	//
+	using directive_bucket = std::vector<const std::pair<directive::instance, directive::instance>*>;
+	struct egraph_directive_table
+	{
+		std::array<directive_bucket, ( size_t ) math::operator_id::max> generic;
+		std::array<directive_bucket, ( size_t ) math::operator_id::max> boolean;
+
+		static const egraph_directive_table& get()
+		{
+			static const egraph_directive_table table = [ ] ()
+			{
+				egraph_directive_table table;
+				for ( auto& dir : directive::universal_simplifiers )        table.generic[ ( size_t ) dir.first.op ].push_back( &dir );
+				for ( auto& dir : directive::join_descriptors )             table.generic[ ( size_t ) dir.first.op ].push_back( &dir );
+				for ( auto& dir : directive::build_boolean_simplifiers() )  table.boolean[ ( size_t ) dir.first.op ].push_back( &dir );
+				for ( auto& dir : directive::boolean_joiners )              table.boolean[ ( size_t ) dir.first.op ].push_back( &dir );
+				return table;
+			}();
+			return table;
+		}
+	};
+
+	// E-graph where each class describes a set of equivalent expressions, and each node is either 
+	// a leaf (constant or variable) or an operator over classes.
+	//
+	struct egraph
+	{
+		struct node
+		{
+			math::operator_id op = math::operator_id::invalid;
+			class_id lhs = invalid_class;
+			class_id rhs = invalid_class;
+			expression::reference leaf = {};
+
+			bool operator==( const node& o ) const
+			{
+				if ( op != o.op ) return false;
+				if ( op == math::operator_id::invalid ) return leaf->is_identical( *o.leaf );
+				return lhs == o.lhs && rhs == o.rhs;
+			}
+		};
+		struct node_hasher
+		{
+			size_t operator()( const node& n ) const noexcept
+			{
+				if ( n.op == math::operator_id::invalid )
+					return n.leaf->hash().as64();
+				return make_hash( n.op, n.lhs, n.rhs ).as64();
+			}
+		};
+		struct eclass
+		{
+			std::vector<node> nodes;
+			bitcnt_t size = 0;
+
+			// Least complex term found for this class so far.
+			//
+			expression::reference best;
+
+			// Properties of the class used for the matching constraints.
+			//
+			std::optional<uint64_t> constant;
+			bool has_variable = false;
+			bool has_expression = false;
+		};
+
+		std::vector<class_id> parents;
+		std::vector<eclass> classes;
+		std::unordered_map<node, class_id, node_hasher> memo;
+		size_t node_count = 0;
+		bool dirty = false;
+
+		// Union-find.
+		//
+		class_id find( class_id id )
+		{
+			while ( parents[ id ] != id )
+				id = parents[ id ] = parents[ parents[ id ] ];
+			return id;
+		}
+		bool merge( class_id a, class_id b )
+		{
+			a = find( a ); b = find( b );
+			if ( a == b )
+				return false;
+			if ( classes[ a ].nodes.size() < classes[ b ].nodes.size() )
+				std::swap( a, b );
+
+			auto& ca = classes[ a ];
+			auto& cb = classes[ b ];
+			ca.nodes.insert( ca.nodes.end(), std::make_move_iterator( cb.nodes.begin() ), std::make_move_iterator( cb.nodes.end() ) );
+			if ( cb.best->complexity < ca.best->complexity )
+				ca.best = std::move( cb.best );
+			if ( !ca.constant ) ca.constant = cb.constant;
+			ca.has_variable |= cb.has_variable;
+			ca.has_expression |= cb.has_expression;
+			cb = {};
+			parents[ b ] = a;
+			return dirty = true;
+		}
+
+		// Inserts a node into the class given or a new class if invalid, returns the class it belongs to.
+		//
+		class_id insert( node&& n, bitcnt_t size, const expression::reference& term )
+		{
+			if ( n.op != math::operator_id::invalid )
+			{
+				n.lhs = n.lhs != invalid_class ? find( n.lhs ) : invalid_class;
+				n.rhs = find( n.rhs );
+			}
+			if ( auto it = memo.find( n ); it != memo.end() )
+				return find( it->second );
+
+			class_id id = ( class_id ) classes.size();
+			parents.push_back( id );
+			auto& cls = classes.emplace_back();
+			cls.size = size;
+			cls.best = term;
+			if ( n.op != math::operator_id::invalid )
+				cls.has_expression = true;
+			else if ( n.leaf->is_constant() )
+				cls.constant = n.leaf->value.known_one();
+			else
+				cls.has_variable = true;
+			memo.emplace( n, id );
+			cls.nodes.emplace_back( std::move( n ) );
+			node_count++;
+			dirty = true;
+			return id;
+		}
+
+		// Adds the expression into the graph, returns the class it belongs to.
+		//
+		class_id add( const expression::reference& exp )
+		{
+			if ( !exp->is_expression() )
+				return insert( node{ .leaf = exp }, exp->size(), exp );
+
+			node n = { .op = exp->op };
+			if ( exp->lhs ) n.lhs = add( exp->lhs );
+			n.rhs = add( exp->rhs );
+			class_id id = insert( std::move( n ), exp->size(), exp );
+
+			// Fold into a constant if the value is known.
+			//
+			if ( exp->value.is_known() )
+			{
+				expression::reference cst = expression{ exp->value.known_one(), exp->size() };
+				merge( id, insert( node{ .leaf = cst }, cst->size(), cst ) );
+			}
+			return find( id );
+		}
+
+		// Restores the congruence invariant after merges, folding the operations 
+		// with constant operands.
+		//
+		void rebuild()
+		{
+			while ( dirty )
+			{
+				dirty = false;
+				memo.clear();
+
+				std::vector<std::pair<class_id, class_id>> pending;
+				std::vector<std::pair<class_id, expression::reference>> folds;
+				for ( class_id id = 0; id != classes.size(); id++ )
+				{
+					if ( find( id ) != id )
+						continue;
+					auto& cls = classes[ id ];
+					for ( auto& n : cls.nodes )
+					{
+						if ( n.op != math::operator_id::invalid )
+						{
+							n.lhs = n.lhs != invalid_class ? find( n.lhs ) : invalid_class;
+							n.rhs = find( n.rhs );
+
+							if ( !cls.constant && classes[ n.rhs ].constant && ( n.lhs == invalid_class || classes[ n.lhs ].constant ) )
+							{
+								auto term = make_term( n );
+								if ( term->value.is_known() )
+									folds.emplace_back( id, expression::reference{ expression{ term->value.known_one(), term->size() } } );
+							}
+						}
+						auto [it, inserted] = memo.emplace( n, id );
+						if ( !inserted && find( it->second ) != id )
+							pending.emplace_back( it->second, id );
+					}
+				}
+
+				for ( auto& [a, b] : pending )
+					merge( a, b );
+				for ( auto& [id, cst] : folds )
+					merge( id, insert( node{ .leaf = cst }, cst->size(), cst ) );
+
+				// Remove duplicate nodes from the classes.
+				//
+				if ( !dirty )
+				{
+					node_count = 0;
+					for ( class_id id = 0; id != classes.size(); id++ )
+					{
+						if ( find( id ) != id )
+							continue;
+						auto& nodes = classes[ id ].nodes;
+						for ( size_t i = 0; i < nodes.size(); i++ )
+							for ( size_t j = nodes.size() - 1; j > i; j-- )
+								if ( nodes[ i ] == nodes[ j ] )
+									nodes.erase( nodes.begin() + j );
+						node_count += nodes.size();
+					}
+				}
+			}
+		}
+
+		// Creates the term for the node using the least complex terms of the operands.
+		//
+		expression::reference make_term( const node& n )
+		{
+			if ( n.op == math::operator_id::invalid )
+				return n.leaf;
+			if ( n.lhs == invalid_class )
+				return expression::make( n.op, classes[ find( n.rhs ) ].best );
+			return expression::make( classes[ find( n.lhs ) ].best, n.op, classes[ find( n.rhs ) ].best );
+		}
+
+		// Propagates the least complex terms bottom-up until a fixed point is reached.
+		//
+		void extract( size_t max_passes )
+		{
+			for ( bool changed = true; changed && max_passes; max_passes-- )
+			{
+				changed = false;
+				for ( class_id id = 0; id != classes.size(); id++ )
+				{
+					if ( find( id ) != id )
+						continue;
+					auto& cls = classes[ id ];
+					for ( auto& n : cls.nodes )
+					{
+						auto term = make_term( n );
+						if ( term->complexity < cls.best->complexity )
+						{
+							cls.best = std::move( term );
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+
+		// Checks whether the class satisfies the matching constraint and returns the term to bind.
+		//
+		expression::reference bind_term( directive::matching_type mtype, class_id id )
+		{
+			auto& cls = classes[ id ];
+			auto find_leaf = [ & ] ( bool constant ) -> expression::reference
+			{
+				for ( auto& n : cls.nodes )
+					if ( n.op == math::operator_id::invalid && n.leaf->is_constant() == constant )
+						return n.leaf;
+				return {};
+			};
+
+			switch ( mtype )
+			{
+				case directive::match_any:            return cls.best;
+				case directive::match_variable:       return find_leaf( false );
+				case directive::match_constant:       return find_leaf( true );
+				case directive::match_non_expression: return cls.constant ? find_leaf( true ) : find_leaf( false );
+				case directive::match_non_constant:   return ( cls.constant || !cls.best->unknown_mask() ) ? expression::reference{} : cls.best;
+				case directive::match_expression:
+				{
+					if ( cls.best->is_expression() )
+						return cls.best;
+					for ( auto& n : cls.nodes )
+						if ( n.op != math::operator_id::invalid )
+							return make_term( n );
+					return {};
+				}
+				default: unreachable();
+			}
+		}
+
+		// Matches the directive against the class given, appends each possible binding to the list.
+		//
+		using binding = std::array<class_id, directive::number_of_lookup_indices>;
+		void match( const directive::instance* dir, class_id id, const binding& bind, std::vector<binding>& out )
+		{
+			if ( out.size() >= VTIL_SYMEX_EGRAPH_MATCH_LIMIT )
+				return;
+			id = find( id );
+
+			// If directive is a variable or a constant:
+			//
+			if ( dir->op == math::operator_id::invalid )
+			{
+				auto& cls = classes[ id ];
+				if ( dir->id )
+				{
+					// If already bound, the classes must be the same.
+					//
+					class_id prev = bind[ dir->lookup_index ];
+					if ( prev != invalid_class )
+					{
+						if ( find( prev ) == id )
+							out.push_back( bind );
+					}
+					else if ( bind_term( dir->mtype, id ) )
+					{
+						out.push_back( bind );
+						out.back()[ dir->lookup_index ] = id;
+					}
+				}
+				else
+				{
+					uint64_t mask = math::fill( cls.size );
+					if ( cls.constant && ( ( *cls.constant ^ dir->value.known_one() ) & mask ) == 0 )
+						out.push_back( bind );
+				}
+				return;
+			}
+
+			// Match each node with the same operator, nodes are copied since matching does not modify the graph.
+			//
+			bool commutative = math::descriptor_of( dir->op ).is_commutative;
+			std::vector<binding> tmp;
+			for ( size_t i = 0; i != classes[ id ].nodes.size(); i++ )
+			{
+				const node n = classes[ id ].nodes[ i ];
+				if ( n.op != dir->op )
+					continue;
+
+				if ( n.lhs == invalid_class )
+				{
+					match( dir->rhs, n.rhs, bind, out );
+					continue;
+				}
+
+				for ( auto [lhs, rhs] : { std::pair{ n.lhs, n.rhs }, std::pair{ n.rhs, n.lhs } } )
+				{
+					tmp.clear();
+					match( dir->rhs, rhs, bind, tmp );
+					for ( auto& b : tmp )
+						match( dir->lhs, lhs, b, out );
+					if ( !commutative || find( n.lhs ) == find( n.rhs ) )
+						break;
+				}
+			}
+		}
+
+		// Applies the rewrite to the class given, returns whether the graph changed.
+		//
+		bool apply( class_id id, const binding& bind, const directive::instance* from, const directive::instance* to )
+		{
+			// Create the symbol table from the terms of each bound class.
+			//
+			std::array<expression::reference, directive::number_of_lookup_indices> terms;
+			directive::symbol_table_t sym = {};
+			bool is_valid = true;
+			from->enum_variables( [ & ] ( const directive::instance& var )
+			{
+				class_id cid = bind[ var.lookup_index ];
+				if ( cid == invalid_class )
+					return;
+				auto& term = terms[ var.lookup_index ];
+				if ( term = bind_term( var.mtype, find( cid ) ) )
+					sym.lookup_table[ var.lookup_index ] = term;
+				else
+					is_valid = false;
+			} );
+			if ( !is_valid )
+				return false;
+
+			// Translate the directive.
+			//
+			bitcnt_t size = classes[ id ].size;
+			auto exp_new = translate( sym, to, size, true );
+			if ( !exp_new )
+				return false;
+			if ( exp_new->size() != size )
+			{
+				if ( !exp_new->is_constant() )
+					return false;
+				exp_new = expression{ *exp_new->value.get(), size };
+			}
+			return merge( id, add( exp_new ) );
+		}
+	};
+
+	// Attempts to simplify the expression given by equality saturation over the simplifier 
+	// directives, extracting the least complex equivalent term found within the budget.
+	//
+	bool simplify_expression_egraph( expression::reference& exp, bool pretty, bool unpack, const egraph_budget& budget )
+	{
+		using namespace logger;
+		if ( !exp->is_expression() )
+			return false;
+
+		auto t0 = std::chrono::steady_clock::now();
+		auto out_of_time = [ & ] () { return budget.time_limit.count() && ( std::chrono::steady_clock::now() - t0 ) > budget.time_limit; };
+
+		// Seed the graph with the input and the result of the greedy simplifier, so that the 
+		// result is never more complex than what the greedy simplifier produces.
+		//
+		expression::reference greedy = exp;
+		simplify_expression( greedy, false, unpack );
+
+		egraph graph;
+		class_id root = graph.add( exp );
+		graph.merge( root, graph.add( greedy ) );
+		graph.rebuild();
+
+		// Saturate until no rewrite changes the graph or until we run out of budget.
+		//
+		auto& table = egraph_directive_table::get();
+		for ( size_t iteration = 0; iteration != budget.iteration_limit; iteration++ )
+		{
+			// Collect all matches first, so that the rewrites do not invalidate the matching.
+			//
+			struct match_entry
+			{
+				class_id id;
+				egraph::binding bind;
+				const std::pair<directive::instance, directive::instance>* dir;
+			};
+			std::vector<match_entry> matches;
+			std::vector<egraph::binding> bindings;
+			egraph::binding empty_binding;
+			empty_binding.fill( invalid_class );
+
+			for ( class_id id = 0; id != graph.classes.size(); id++ )
+			{
+				if ( graph.find( id ) != id || graph.classes[ id ].constant )
+					continue;
+
+				std::bitset<( size_t ) math::operator_id::max> ops = {};
+				for ( auto& n : graph.classes[ id ].nodes )
+					if ( n.op != math::operator_id::invalid )
+						ops.set( ( size_t ) n.op );
+
+				for ( size_t op = 0; op != ops.size(); op++ )
+				{
+					if ( !ops.test( op ) ) continue;
+					for ( auto* buckets : { &table.generic, &table.boolean } )
+					{
+						if ( buckets == &table.boolean && graph.classes[ id ].size != 1 )
+							continue;
+						for ( auto* dir : ( *buckets )[ op ] )
+						{
+							bindings.clear();
+							graph.match( &dir->first, id, empty_binding, bindings );
+							for ( auto& bind : bindings )
+								matches.push_back( { id, bind, dir } );
+						}
+					}
+				}
+			}
+
+			// Apply each rewrite.
+			//
+			bool changed = false;
+			for ( auto& entry : matches )
+			{
+				if ( graph.node_count >= budget.node_limit || out_of_time() )
+					break;
+				changed |= graph.apply( graph.find( entry.id ), entry.bind, &entry.dir->first, &entry.dir->second );
+			}
+			graph.rebuild();
+			graph.extract( 4 );
+
+#if VTIL_SYMEX_SIMPLIFY_VERBOSE
+			log<CON_BLU>( "[E-Graph] Iteration %d: %d classes, %d nodes, %d matches\n", iteration, graph.classes.size(), graph.node_count, matches.size() );
+#endif
+			if ( !changed || graph.node_count >= budget.node_limit || out_of_time() )
+				break;
+		}
+
+		// Extract the least complex term, normalize it using the greedy simplifier and pick it
+		// over the greedy result only if it is less complex.
+		//
+		graph.extract( 64 );
+		expression::reference result = graph.classes[ graph.find( root ) ].best;
+		simplify_expression( result, false, unpack );
+		if ( result->complexity >= greedy->complexity )
+			result = std::move( greedy );
+		result->simplify_hint = true;
+
+		if ( pretty )
+			simplify_expression( result, true, unpack );
+
+		if ( exp->is_identical( *result ) )
+			return false;
+		exp = std::move( result );
+		return true;
+	}
+};
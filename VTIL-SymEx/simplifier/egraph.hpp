@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Can Boluk and contributors of the VTIL Project   
+// All rights reserved.   
+//    
+// Redistribution and use in source and binary forms, with or without   
+// modification, are permitted provided that the following conditions are met: 
+//    
+// 1. Redistributions of source code must retain the above copyright notice,   
+//    this list of conditions and the following disclaimer.   
+// 2. Redistributions in binary form must reproduce the above copyright   
+//    notice, this list of conditions and the following disclaimer in the   
+//    documentation and/or other materials provided with the distribution.   
+// 3. Neither the name of VTIL Project nor the names of its contributors
+//    may be used to endorse or promote products derived from this software 
+//    without specific prior written permission.   
+//    
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE   
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE  
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE   
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR   
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF   
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS   
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN   
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)   
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE  
+// POSSIBILITY OF SUCH DAMAGE.        
+//
+#pragma once
+#include <chrono>
+#include "../expressions/expression.hpp"
+
+// [Configuration]
+// Determine the default budget of the equality saturation based simplifier, saturation
+// stops as soon as any of the limits is reached. The wall-clock limit is disabled (0) by
+// default since it makes the result depend on the load of the machine.
+//
+#ifndef VTIL_SYMEX_EGRAPH_NODE_LIMIT
+	#define VTIL_SYMEX_EGRAPH_NODE_LIMIT          2048
+#endif
+#ifndef VTIL_SYMEX_EGRAPH_ITERATION_LIMIT
+	#define VTIL_SYMEX_EGRAPH_ITERATION_LIMIT     8
+#endif
+#ifndef VTIL_SYMEX_EGRAPH_TIME_LIMIT_MS
+	#define VTIL_SYMEX_EGRAPH_TIME_LIMIT_MS       0
+#endif
+#ifndef VTIL_SYMEX_EGRAPH_MATCH_LIMIT
+	#define VTIL_SYMEX_EGRAPH_MATCH_LIMIT         16
+#endif
+
+namespace vtil::symbolic
+{
+	// Budget of the equality saturation, a zero time limit means no time limit.
+	//
+	struct egraph_budget
+	{
+		size_t node_limit = VTIL_SYMEX_EGRAPH_NODE_LIMIT;
+		size_t iteration_limit = VTIL_SYMEX_EGRAPH_ITERATION_LIMIT;
+		std::chrono::milliseconds time_limit = std::chrono::milliseconds{ VTIL_SYMEX_EGRAPH_TIME_LIMIT_MS };
+	};
+
+	// Attempts to simplify the expression given by equality saturation over the simplifier 
+	// directives, extracting the least complex equivalent term found within the budget.
+	// Returns whether the simplification succeeded or not.
+	//
+	bool simplify_expression_egraph( expression::reference& exp, bool pretty = false, bool unpack = true, const egraph_budget& budget = {} );
+};
@@ -28,24 +28,61 @@
 #include "simplifier.hpp"
 #include "directives.hpp"
 #include "boolean_directives.hpp"
+#include "egraph.hpp"
 #include "../expressions/expression.hpp"
+#include "../expressions/interning.hpp"
 #include "../directives/transformer.hpp"
 #include <vtil/io>
 #include <vtil/utility>
+#include <shared_mutex>
+#include <unordered_set>
+#include <deque>
+#include <chrono>
+#include <mutex>
 
 // [Configuration]
-// Determine the depth limit after which we start self generated signature matching and
-// the properties of the LRU cache.
+// Determine the depth limit after which we start self generated signature matching, the
+// number of structurally equivalent entries tried per lookup and the properties of the LRU cache.
 //
 #ifndef VTIL_SYMEX_SELFGEN_SIGMATCH_DEPTH_LIM
 	#define	VTIL_SYMEX_SELFGEN_SIGMATCH_DEPTH_LIM   3
 #endif
+#ifndef VTIL_SYMEX_SELFGEN_SIGMATCH_SCAN_LIM
+	#define	VTIL_SYMEX_SELFGEN_SIGMATCH_SCAN_LIM    16
+#endif
 #ifndef VTIL_SYMEX_LRU_CACHE_SIZE
 	#define VTIL_SYMEX_LRU_CACHE_SIZE               0x10000
 #endif
 #ifndef VTIL_SYMEX_LRU_PRUNE_COEFF
 	#define VTIL_SYMEX_LRU_PRUNE_COEFF              0.35
 #endif
+
+// [Configuration]
+// Determine the maximum number of entries in the simplifier cache shared between 
+// threads, the number of shards it is split into and the minimum expression depth
+// for which it is used. The cache is disabled if references are thread-confined.
+//
+#ifndef VTIL_SYMEX_SHARED_CACHE_SIZE
+	#define VTIL_SYMEX_SHARED_CACHE_SIZE            ( VTIL_SHARED_REFERENCE_ATOMIC ? 0x40000 : 0 )
+#endif
+#ifndef VTIL_SYMEX_SHARED_CACHE_SHARDS
+	#define VTIL_SYMEX_SHARED_CACHE_SHARDS          64
+#endif
+#ifndef VTIL_SYMEX_SHARED_CACHE_MIN_DEPTH
+	#define VTIL_SYMEX_SHARED_CACHE_MIN_DEPTH       2
+#endif
+static_assert( VTIL_SHARED_REFERENCE_ATOMIC || !VTIL_SYMEX_SHARED_CACHE_SIZE, "Thread-confined references cannot be used with the shared simplifier cache." );
+
+// [Configuration]
+// Determine the minimum depth of a subtree that is split into its operands when simplifying
+// a single expression on multiple workers, and the number of subtrees created per worker.
+//
+#ifndef VTIL_SYMEX_PARALLEL_SPLIT_DEPTH
+	#define VTIL_SYMEX_PARALLEL_SPLIT_DEPTH         8
+#endif
+#ifndef VTIL_SYMEX_PARALLEL_SPLIT_FACTOR
+	#define VTIL_SYMEX_PARALLEL_SPLIT_FACTOR        4
+#endif
 namespace vtil::symbolic
 {
 	struct join_depth_exception : std::exception
@@ -61,7 +98,131 @@ namespace vtil::symbolic
 	using static_directive_table_entry =  std::pair<directive::instance,        directive::instance>;
 	using dynamic_directive_table_entry = std::pair<const directive::instance*, const directive::instance*>;
 
-	using dynamic_directive_table =       std::vector<dynamic_directive_table_entry>;
+	// Each operand of an expression is classified into a key, being either a constant, a variable or
+	// the operator of the sub-expression, and each operand of a directive is compiled into the mask of
+	// keys it can possibly match so that candidates can be filtered without invoking the matcher.
+	//
+	using operand_mask = uint64_t;
+	static constexpr size_t operand_key_constant = 0;
+	static constexpr size_t operand_key_variable = 1;
+	static constexpr size_t operand_key_count =    2 + ( size_t ) math::operator_id::max;
+	static_assert( operand_key_count <= 64, "Operand keys do not fit in the mask." );
+
+	static constexpr operand_mask operand_mask_constant =   1ull << operand_key_constant;
+	static constexpr operand_mask operand_mask_variable =   1ull << operand_key_variable;
+	static constexpr operand_mask operand_mask_any =        math::fill( operand_key_count );
+	static constexpr operand_mask operand_mask_expression = operand_mask_any & ~( operand_mask_constant | operand_mask_variable );
+
+	static operand_mask classify_operand( const expression& exp )
+	{
+		// Expressions that are not folded yet may match both constants and their operator.
+		//
+		operand_mask mask = exp.is_constant() ? operand_mask_constant : 0;
+		if ( exp.is_expression() )
+			mask |= 1ull << ( 2 + ( size_t ) exp.op );
+		else if ( exp.is_variable() )
+			mask |= operand_mask_variable;
+		return mask;
+	}
+	static operand_mask compile_operand( const directive::instance* dir )
+	{
+		// If operator, can only match the same operator, directive operators never match.
+		//
+		if ( dir->op != math::operator_id::invalid )
+			return dir->op < math::operator_id::max ? 1ull << ( 2 + ( size_t ) dir->op ) : 0;
+
+		// If constant, can only match constants.
+		//
+		if ( !dir->id )
+			return operand_mask_constant;
+
+		// If variable, translate the matching type.
+		//
+		switch ( dir->mtype )
+		{
+			case directive::match_any:            return operand_mask_any;
+			case directive::match_variable:       return operand_mask_variable;
+			case directive::match_constant:       return operand_mask_constant;
+			case directive::match_expression:     return operand_mask_expression;
+			case directive::match_non_constant:   return operand_mask_variable | operand_mask_expression;
+			case directive::match_non_expression: return operand_mask_variable | operand_mask_constant;
+			default:                              unreachable();
+		}
+	}
+
+	// Directive table of a single operator, compiled into a discrimination table indexed by the
+	// key of the right hand side operand (or either of the operands if commutative).
+	//
+	struct dynamic_directive_table
+	{
+		struct entry_masks
+		{
+			operand_mask lhs;
+			operand_mask rhs;
+		};
+
+		bool is_commutative = false;
+		std::vector<dynamic_directive_table_entry> entries;
+		std::vector<entry_masks> masks;
+
+		// Index list for each key, last entry is used when the key is ambiguous and lists all entries.
+		//
+		std::array<std::vector<uint32_t>, operand_key_count + 1> candidates;
+
+		// Checks whether the entry can match the operands with the given masks.
+		//
+		bool can_match( uint32_t idx, operand_mask lhs, operand_mask rhs ) const
+		{
+			auto& m = masks[ idx ];
+			if ( ( m.lhs & lhs ) && ( m.rhs & rhs ) )
+				return true;
+			return is_commutative && ( m.lhs & rhs ) && ( m.rhs & lhs );
+		}
+
+		// Iterates the entries that can match the expression, in their original order.
+		//
+		struct candidate_range
+		{
+			const dynamic_directive_table* table;
+			const uint32_t* first;
+			const uint32_t* last;
+			operand_mask lhs;
+			operand_mask rhs;
+
+			struct iterator
+			{
+				const candidate_range* range;
+				const uint32_t* it;
+
+				iterator& skip()
+				{
+					while ( it != range->last && !range->table->can_match( *it, range->lhs, range->rhs ) )
+						++it;
+					return *this;
+				}
+				iterator& operator++() { ++it; return skip(); }
+				bool operator!=( const iterator& o ) const { return it != o.it; }
+				const dynamic_directive_table_entry& operator*() const { return range->table->entries[ *it ]; }
+			};
+			iterator begin() const { return iterator{ this, first }.skip(); }
+			iterator end() const { return iterator{ this, last }; }
+		};
+		candidate_range lookup( const expression& exp ) const
+		{
+			// Skip classification if there are no entries, expression may not even be an operation.
+			//
+			if ( entries.empty() )
+				return { this, nullptr, nullptr, 0, 0 };
+
+			// Unary operators will have the left hand side mask set to any.
+			//
+			operand_mask lhs = exp.lhs ? classify_operand( *exp.lhs ) : operand_mask_any;
+			operand_mask rhs = classify_operand( *exp.rhs );
+
+			auto& list = candidates[ ( rhs & ( rhs - 1 ) ) == 0 ? math::lsb( rhs ) - 1 : operand_key_count ];
+			return { this, list.data(), list.data() + list.size(), lhs, rhs };
+		}
+	};
 	using organized_directive_table =     std::array<dynamic_directive_table, ( size_t ) math::operator_id::max>;
 
 	template<typename T>
@@ -69,18 +230,353 @@ namespace vtil::symbolic
 	{
 		organized_directive_table table;
 		for ( auto [table, op] : zip( table, iindices ) )
-			for( auto& directive : container )
-				if ( directive.first.op == ( math::operator_id ) op )
-					table.emplace_back( &directive.first, &directive.second );
+		{
+			if ( op == ( size_t ) math::operator_id::invalid )
+				continue;
+			table.is_commutative = math::descriptor_of( ( math::operator_id ) op ).is_commutative;
+
+			for ( auto& directive : container )
+			{
+				if ( directive.first.op != ( math::operator_id ) op )
+					continue;
+
+				operand_mask lhs = directive.first.lhs ? compile_operand( directive.first.lhs ) : operand_mask_any;
+				operand_mask rhs = compile_operand( directive.first.rhs );
+				operand_mask keys = table.is_commutative ? ( lhs | rhs ) : rhs;
+
+				uint32_t idx = ( uint32_t ) table.entries.size();
+				table.entries.emplace_back( &directive.first, &directive.second );
+				table.masks.push_back( { lhs, rhs } );
+				for ( size_t key = 0; key != operand_key_count; key++ )
+					if ( keys & ( 1ull << key ) )
+						table.candidates[ key ].push_back( idx );
+				table.candidates[ operand_key_count ].push_back( idx );
+			}
+		}
 		return table;
 	};
 
-	static auto& get_boolean_joiners( math::operator_id op )       { static const auto tbl = build_dynamic_table( directive::boolean_joiners );             return tbl[ ( size_t ) op ]; }
-	static auto& get_pack_descriptors( math::operator_id op )      { static const auto tbl = build_dynamic_table( directive::pack_descriptors );            return tbl[ ( size_t ) op ]; }
-	static auto& get_join_descriptors( math::operator_id op )      { static const auto tbl = build_dynamic_table( directive::join_descriptors );            return tbl[ ( size_t ) op ]; }
-	static auto& get_unpack_descriptors( math::operator_id op )    { static const auto tbl = build_dynamic_table( directive::unpack_descriptors );          return tbl[ ( size_t ) op ]; }
-	static auto& get_boolean_simplifiers( math::operator_id op )   { static const auto tbl = build_dynamic_table( directive::build_boolean_simplifiers() ); return tbl[ ( size_t ) op ]; }
-	static auto& get_universal_simplifiers( math::operator_id op ) { static const auto tbl = build_dynamic_table( directive::universal_simplifiers );       return tbl[ ( size_t ) op ]; }
+	static auto get_boolean_joiners( const expression& exp )       { static const auto tbl = build_dynamic_table( directive::boolean_joiners );             return tbl[ ( size_t ) exp.op ].lookup( exp ); }
+	static auto get_pack_descriptors( const expression& exp )      { static const auto tbl = build_dynamic_table( directive::pack_descriptors );            return tbl[ ( size_t ) exp.op ].lookup( exp ); }
+	static auto get_join_descriptors( const expression& exp )      { static const auto tbl = build_dynamic_table( directive::join_descriptors );            return tbl[ ( size_t ) exp.op ].lookup( exp ); }
+	static auto get_unpack_descriptors( const expression& exp )    { static const auto tbl = build_dynamic_table( directive::unpack_descriptors );          return tbl[ ( size_t ) exp.op ].lookup( exp ); }
+	static auto get_boolean_simplifiers( const expression& exp )   { static const auto tbl = build_dynamic_table( directive::build_boolean_simplifiers() ); return tbl[ ( size_t ) exp.op ].lookup( exp ); }
+	static auto get_universal_simplifiers( const expression& exp ) { static const auto tbl = build_dynamic_table( directive::universal_simplifiers );       return tbl[ ( size_t ) exp.op ].lookup( exp ); }
+
+	// Registry of all directives used by the simplifier, used to assign each one a linear index.
+	//
+	struct directive_registry
+	{
+		struct table_range
+		{
+			const char* name;
+			const static_directive_table_entry* entries;
+			size_t count;
+			size_t base;
+		};
+		std::vector<table_range> tables;
+		size_t count = 0;
+
+		template<typename T>
+		void add( const char* name, const T& table )
+		{
+			tables.push_back( { name, std::data( table ), std::size( table ), count } );
+			count += std::size( table );
+		}
+
+		// Returns the index of the directive given the source instance, or ~0 if not found.
+		//
+		size_t index_of( const directive::instance* src ) const
+		{
+			for ( auto& table : tables )
+			{
+				const auto* first = ( const uint8_t* ) &table.entries[ 0 ].first;
+				const auto* last = ( const uint8_t* ) &table.entries[ table.count ].first;
+				if ( first <= ( const uint8_t* ) src && ( const uint8_t* ) src < last )
+					return table.base + ( ( const uint8_t* ) src - first ) / sizeof( static_directive_table_entry );
+			}
+			return ~0ull;
+		}
+
+		static const directive_registry& get()
+		{
+			static const directive_registry registry = [ ] ()
+			{
+				directive_registry registry;
+				registry.add( "universal_simplifiers", directive::universal_simplifiers );
+				registry.add( "boolean_simplifiers",   directive::build_boolean_simplifiers() );
+				registry.add( "join_descriptors",      directive::join_descriptors );
+				registry.add( "boolean_joiners",       directive::boolean_joiners );
+				registry.add( "pack_descriptors",      directive::pack_descriptors );
+				registry.add( "unpack_descriptors",    directive::unpack_descriptors );
+				return registry;
+			}();
+			return registry;
+		}
+	};
+
+	// Counters of the simplifier, each thread owns a set registered to a global list so that they
+	// can be merged on demand, counters of the threads that exit are merged into the retired set.
+	//
+	struct simplifier_counters
+	{
+		using counter = std::atomic<uint64_t>;
+		struct directive_counter
+		{
+			counter attempts = 0;
+			counter successes = 0;
+			counter time_ns = 0;
+		};
+
+		counter cache_hits = 0;
+		counter cache_misses = 0;
+		counter cache_signature_hits = 0;
+		counter cache_prunes = 0;
+		counter cache_evictions = 0;
+		counter depth_limit_bailouts = 0;
+		counter join_bailouts = 0;
+		counter budget_bailouts = 0;
+		std::unique_ptr<directive_counter[]> directives{ new directive_counter[ directive_registry::get().count ] };
+
+		// Invokes the enumerator for each pair of counters.
+		//
+		template<typename F>
+		void enum_counters( simplifier_counters& o, F&& fn )
+		{
+			fn( cache_hits, o.cache_hits );
+			fn( cache_misses, o.cache_misses );
+			fn( cache_signature_hits, o.cache_signature_hits );
+			fn( cache_prunes, o.cache_prunes );
+			fn( cache_evictions, o.cache_evictions );
+			fn( depth_limit_bailouts, o.depth_limit_bailouts );
+			fn( join_bailouts, o.join_bailouts );
+			fn( budget_bailouts, o.budget_bailouts );
+			for ( size_t n = 0; n != directive_registry::get().count; n++ )
+			{
+				fn( directives[ n ].attempts, o.directives[ n ].attempts );
+				fn( directives[ n ].successes, o.directives[ n ].successes );
+				fn( directives[ n ].time_ns, o.directives[ n ].time_ns );
+			}
+		}
+
+		// Counters are incremented by the owning thread but may be reset from any thread, so the
+		// increment has to be atomic for the reset not to be lost.
+		//
+		static void increment( counter& value, uint64_t n = 1 )
+		{
+			value.fetch_add( n, std::memory_order::relaxed );
+		}
+	};
+	struct simplifier_counter_list
+	{
+		std::mutex mtx;
+		std::vector<simplifier_counters*> active;
+		simplifier_counters retired;
+
+		// Merges all counters into the given instance.
+		//
+		void merge( simplifier_counters& out )
+		{
+			std::lock_guard _g{ mtx };
+			for ( auto* counters : active )
+				out.enum_counters( *counters, [ ] ( auto& a, auto& b ) { a += b.load( std::memory_order::relaxed ); } );
+			out.enum_counters( retired, [ ] ( auto& a, auto& b ) { a += b.load( std::memory_order::relaxed ); } );
+		}
+
+		// Resets all counters.
+		//
+		void reset()
+		{
+			std::lock_guard _g{ mtx };
+			for ( auto* counters : active )
+				counters->enum_counters( *counters, [ ] ( auto& a, auto& ) { a.store( 0, std::memory_order::relaxed ); } );
+			retired.enum_counters( retired, [ ] ( auto& a, auto& ) { a.store( 0, std::memory_order::relaxed ); } );
+		}
+
+		// List is intentionally leaked to avoid destruction order issues with the thread locals.
+		//
+		static simplifier_counter_list& get()
+		{
+			static simplifier_counter_list* list = new simplifier_counter_list();
+			return *list;
+		}
+	};
+	struct local_simplifier_counters : simplifier_counters
+	{
+		local_simplifier_counters()
+		{
+			auto& list = simplifier_counter_list::get();
+			std::lock_guard _g{ list.mtx };
+			list.active.push_back( this );
+		}
+		~local_simplifier_counters()
+		{
+			auto& list = simplifier_counter_list::get();
+			std::lock_guard _g{ list.mtx };
+			list.retired.enum_counters( *this, [ ] ( auto& a, auto& b ) { a += b.load( std::memory_order::relaxed ); } );
+			list.active.erase( std::find( list.active.begin(), list.active.end(), this ) );
+		}
+	};
+#if VTIL_SYMEX_SIMPLIFY_STATISTICS
+	static thread_local local_simplifier_counters local_counters;
+	#define VTIL_SYMEX_COUNT( field, ... ) simplifier_counters::increment( local_counters.field, ##__VA_ARGS__ )
+#else
+	#define VTIL_SYMEX_COUNT( field, ... )
+#endif
+
+	// Budget of the current top level simplification, once exhausted every directive attempt and
+	// every nested simplification fails so that the expression is left as is. If the simplification
+	// is split between workers, attempts are counted on the shared counter instead.
+	//
+	struct simplifier_budget_state
+	{
+		simplifier_budget limit = {};
+		size_t attempts = 0;
+		std::chrono::steady_clock::time_point deadline = {};
+		bool exhausted = false;
+		std::atomic<size_t>* shared_attempts = nullptr;
+
+		// Resets the counters for a new top level simplification.
+		//
+		void begin()
+		{
+			attempts = 0;
+			exhausted = false;
+			if ( limit.time_limit.count() )
+				deadline = std::chrono::steady_clock::now() + limit.time_limit;
+		}
+
+		// Consumes a directive attempt, returns false if the budget is exhausted. Time limit is
+		// only checked every few attempts since reading the clock costs as much as a failed match.
+		//
+		bool consume()
+		{
+			if ( exhausted )
+				return false;
+			size_t n = shared_attempts ? shared_attempts->fetch_add( 1, std::memory_order::relaxed ) + 1 : ++attempts;
+			if ( ( limit.attempt_limit && n > limit.attempt_limit ) ||
+				 ( limit.time_limit.count() && !( n & 31 ) && std::chrono::steady_clock::now() >= deadline ) )
+			{
+				VTIL_SYMEX_COUNT( budget_bailouts );
+				exhausted = true;
+				return false;
+			}
+			return true;
+		}
+	};
+	static thread_local simplifier_budget_state local_budget;
+
+	// Number of workers a single top level simplification on the current thread can use.
+	//
+	static thread_local size_t local_worker_count = VTIL_SYMEX_SIMPLIFY_WORKERS;
+
+	// Wrapper around transform counting the attempts, successes and the time spent for each directive.
+	//
+	template<typename... Tx>
+	static expression::reference transform_counted( const expression::reference& exp, const directive::instance* from, const directive::instance* to, Tx&&... filters )
+	{
+		if ( !local_budget.consume() )
+			return {};
+#if VTIL_SYMEX_SIMPLIFY_STATISTICS
+		size_t idx = directive_registry::get().index_of( from );
+		if ( idx == ~0ull )
+			return transform( exp, from, to, std::forward<Tx>( filters )... );
+
+		auto& counter = local_counters.directives[ idx ];
+		auto t0 = std::chrono::steady_clock::now();
+		auto result = transform( exp, from, to, std::forward<Tx>( filters )... );
+		auto t1 = std::chrono::steady_clock::now();
+		simplifier_counters::increment( counter.attempts );
+		simplifier_counters::increment( counter.time_ns, std::chrono::duration_cast< std::chrono::nanoseconds >( t1 - t0 ).count() );
+		if ( result )
+			simplifier_counters::increment( counter.successes );
+		return result;
+#else
+		return transform( exp, from, to, std::forward<Tx>( filters )... );
+#endif
+	}
+
+	simplifier_statistics get_simplifier_statistics()
+	{
+		simplifier_statistics result = {};
+		result.shared_cache = get_shared_simplifier_cache_statistics();
+#if VTIL_SYMEX_SIMPLIFY_STATISTICS
+		simplifier_counters counters;
+		simplifier_counter_list::get().merge( counters );
+
+		result.cache_hits =           counters.cache_hits;
+		result.cache_misses =         counters.cache_misses;
+		result.cache_signature_hits = counters.cache_signature_hits;
+		result.cache_prunes =         counters.cache_prunes;
+		result.cache_evictions =      counters.cache_evictions;
+		result.depth_limit_bailouts = counters.depth_limit_bailouts;
+		result.join_bailouts =        counters.join_bailouts;
+		result.budget_bailouts =      counters.budget_bailouts;
+
+		for ( auto& table : directive_registry::get().tables )
+		{
+			for ( size_t n = 0; n != table.count; n++ )
+			{
+				auto& counter = counters.directives[ table.base + n ];
+				if ( !counter.attempts )
+					continue;
+				result.directives.push_back( {
+					.table =     table.name,
+					.index =     n,
+					.source =    table.entries[ n ].first.to_string(),
+					.target =    table.entries[ n ].second.to_string(),
+					.attempts =  counter.attempts,
+					.successes = counter.successes,
+					.time_ns =   counter.time_ns
+				} );
+			}
+		}
+#endif
+		return result;
+	}
+	void reset_simplifier_statistics()
+	{
+#if VTIL_SYMEX_SIMPLIFY_STATISTICS
+		simplifier_counter_list::get().reset();
+#endif
+	}
+	std::string simplifier_statistics::to_json() const
+	{
+		auto escape = [ ] ( const std::string& in )
+		{
+			std::string out;
+			for ( char c : in )
+			{
+				if ( c == '"' || c == '\\' )
+					out += '\\';
+				out += c;
+			}
+			return out;
+		};
+
+		std::string out = format::str(
+			"{\n"
+			"  \"cache\": { \"hits\": %llu, \"misses\": %llu, \"signature_hits\": %llu, \"prunes\": %llu, \"evictions\": %llu },\n"
+			"  \"shared_cache\": { \"size\": %llu, \"hits\": %llu, \"misses\": %llu, \"insertions\": %llu, \"evictions\": %llu },\n"
+			"  \"depth_limit_bailouts\": %llu,\n"
+			"  \"join_bailouts\": %llu,\n"
+			"  \"budget_bailouts\": %llu,\n"
+			"  \"directives\": [",
+			cache_hits, cache_misses, cache_signature_hits, cache_prunes, cache_evictions,
+			shared_cache.size, shared_cache.hits, shared_cache.misses, shared_cache.insertions, shared_cache.evictions,
+			depth_limit_bailouts, join_bailouts, budget_bailouts
+		);
+		for ( auto& dir : directives )
+		{
+			out += format::str(
+				"%s\n    { \"table\": \"%s\", \"index\": %llu, \"source\": \"%s\", \"target\": \"%s\", \"attempts\": %llu, \"successes\": %llu, \"time_ns\": %llu }",
+				&dir == &directives.front() ? "" : ",",
+				dir.table, dir.index, escape( dir.source ), escape( dir.target ), dir.attempts, dir.successes, dir.time_ns
+			);
+		}
+		out += directives.empty() ? "]\n}" : "\n  ]\n}";
+		return out;
+	}
 
 	// Thread local simplifier state.
 	//
@@ -89,7 +585,7 @@ namespace vtil::symbolic
 		static constexpr size_t max_cache_entries = VTIL_SYMEX_LRU_CACHE_SIZE;
 		static constexpr size_t cache_prune_count = ( size_t ) ( max_cache_entries * VTIL_SYMEX_LRU_PRUNE_COEFF );
 
-		// Declare custom hash / equivalence checks hijacking the hash map iteration.
+		// Cache entry.
 		//
 		struct cache_value
 		{
@@ -102,11 +598,17 @@ namespace vtil::symbolic
 			expression::reference result = {};
 			bool is_simplified = false;
 
+			// Set if the entry was completed after the budget was exhausted, the result may 
+			// be incomplete so it is discarded on the next lookup.
+			//
+			bool is_partial = false;
+
 			// Implementation details:
 			//
 			int32_t lock_count = 0;
 			queue_key lru_key = {};
 			queue_key spec_key = {};
+			queue_key signature_key = {};
 
 			// Stores a type erased iterator since we don't know the map type yet, only
 			// an issue with libstdc++ but oh well.
@@ -125,78 +627,15 @@ namespace vtil::symbolic
 			const auto& iterator() const { return make_mutable( this )->template iterator<map_type>(); }
 		};
 
-
-		struct signature_hasher
-		{
-			hash_t operator()( const expression::reference& ref ) const noexcept { return ref->signature.hash(); }
-		};
-
-		struct cache_scanner
-		{
-			struct sigscan_result
-			{
-				const expression::reference& key;
-				cache_value* match = nullptr;
-				expression::uid_relation_table table;
-				int64_t diff = 0;
-			};
-			inline static thread_local sigscan_result* sigscan = nullptr;
-
-			bool operator()( const expression::reference& a, const expression::reference& b ) const noexcept 
-			{ 
-				// If there's a signature matching request:
-				//
-				if ( sigscan )
-				{
-					// Find out which argument is "this", if failed return false.
-					//
-					auto self = &a, other = &b;
-					if ( a.pointer != sigscan->key.pointer )
-						std::swap( self, other );
-
-					// Skip if not improving the result.
-					//
-					int64_t sdiff = ( *self )->depth - ( *other )->depth;
-					//if ( sdiff < 0 )
-					if( sdiff != 0  )
-						return false;
-					if ( sigscan->match && sdiff > sigscan->diff )
-						return false;
-
-					// Redirect to is identical if they're the same depth:
-					//
-					if ( sdiff == 0 && a.is_identical( *b ) )
-						return true;
-
-					// If other's past depth limit:
-					//
-					if ( ( *other )->depth > VTIL_SYMEX_SELFGEN_SIGMATCH_DEPTH_LIM )
-					{
-						// If matching signature, save the match, steal full value from the reference to the key.
-						//
-						if ( auto vec = ( *other )->match_to( **self, /*false*/ true ) )
-						{
-							sigscan->table = std::move( *vec );
-							using kv_pair = std::pair<const expression::reference, cache_value>;
-							sigscan->match = &( ( kv_pair* ) other )->second;
-							sigscan->diff = sdiff;
-							sigscan = nullptr;
-						}
-					}
-					return false;
-				}
-				// If not sigscanning, check if identical.
-				//
-				else
-				{
-					return a.is_identical( *b );
-				}
-			}
-		};
-
 		// Cache entry and map type.
 		//
-		using cache_map = std::unordered_map<expression::reference, cache_value, signature_hasher, cache_scanner>;
+		using cache_map = std::unordered_map<expression::reference, cache_value, expression::reference::hasher, expression::reference::if_identical>;
+
+		// Secondary index of the entries past the signature matching depth limit, keyed by the shrinked
+		// signature and the depth so that structurally equivalent entries with different variables can 
+		// be found without probing the cache map.
+		//
+		using signature_index = std::unordered_map<hash_t, detached_queue<cache_value>>;
 
 		// Whether we're executing speculatively or not.
 		//
@@ -207,9 +646,10 @@ namespace vtil::symbolic
 		detached_queue<cache_value> lru_queue;
 		detached_queue<cache_value> spec_queue;
 
-		// Cache map.
+		// Cache map and the signature index.
 		//
 		cache_map map{ max_cache_entries };
+		signature_index signatures;
 
 		// Disallow copy.
 		//
@@ -228,6 +668,28 @@ namespace vtil::symbolic
 			is_speculative = false;
 			map.clear();
 			map.reserve( max_cache_entries );
+			signatures.clear();
+		}
+
+		// Merges the complete entries of another state, used to bring back the results of the
+		// simplifications executed on worker threads.
+		//
+		void merge( const simplifier_state& o )
+		{
+			for ( auto& [key, value] : o.map )
+			{
+				if ( value.is_partial || value.lock_count > 0 )
+					continue;
+
+				fassert( ( map.max_load_factor() * map.bucket_count() ) >= ( map.size() + 1 ) );
+				auto [it, inserted] = map.try_emplace( key );
+				if ( !inserted )
+					continue;
+				it->second.result = value.result;
+				it->second.is_simplified = value.is_simplified;
+				init_entry( it );
+				lru_queue.emplace_back( &it->second.lru_key );
+			}
 		}
 
 		// Begins speculative execution.
@@ -271,6 +733,40 @@ namespace vtil::symbolic
 			is_speculative = false;
 		}
 
+		// Gets the key of the expression in the signature index.
+		//
+		static hash_t get_signature_key( const expression::reference& exp )
+		{
+			return make_hash( exp->signature.hash(), exp->depth );
+		}
+
+		// Finds an entry that is structurally equivalent to the expression, returns the entry
+		// and the table mapping its variables to the variables of the expression.
+		//
+		std::pair<cache_value*, expression::uid_relation_table> match_signature( const expression::reference& exp )
+		{
+			auto it = signatures.find( get_signature_key( exp ) );
+			if ( it == signatures.end() )
+				return {};
+
+			// Try the most recently inserted entries first.
+			//
+			size_t n = 0;
+			for ( auto k = it->second.tail; k && n != VTIL_SYMEX_SELFGEN_SIGMATCH_SCAN_LIM; k = k->prev, n++ )
+			{
+				// Skip incomplete entries, entries that are still being simplified are matched
+				// so that recursing into an equivalent expression fails.
+				//
+				cache_value* value = k->get( &cache_value::signature_key );
+				if ( value->is_partial )
+					continue;
+
+				if ( auto table = value->template iterator<cache_map>()->first->match_to( *exp, true ) )
+					return { value, std::move( *table ) };
+			}
+			return {};
+		}
+
 		// Erases a cache entry.
 		//
 		void erase( cache_value* value )
@@ -279,6 +775,13 @@ namespace vtil::symbolic
 			lru_queue.erase( &value->lru_key );
 			if( value->spec_key.is_valid() )
 				spec_queue.erase( &value->spec_key );
+			if ( value->signature_key.is_valid() )
+			{
+				auto it = signatures.find( get_signature_key( value->template iterator<cache_map>()->first ) );
+				it->second.erase( &value->signature_key );
+				if ( it->second.empty() )
+					signatures.erase( it );
+			}
 			map.erase( std::move( value->template iterator<cache_map>() ) );
 		}
 
@@ -295,10 +798,16 @@ namespace vtil::symbolic
 			if ( is_speculative )
 				spec_queue.emplace_back( &entry_it->second.spec_key );
 
+			// If past the depth limit, link to the signature index.
+			//
+			if ( entry_it->first->depth > VTIL_SYMEX_SELFGEN_SIGMATCH_DEPTH_LIM )
+				signatures[ get_signature_key( entry_it->first ) ].emplace_back( &entry_it->second.signature_key );
+
 			// If we reached max entries, prune:
 			//
 			if ( lru_queue.size() == ( max_cache_entries - 1 ) )
 			{
+				VTIL_SYMEX_COUNT( cache_prunes );
 				for ( auto it = lru_queue.head; it && ( lru_queue.size() + cache_prune_count ) > max_cache_entries; )
 				{
 					auto next = it->next;
@@ -306,7 +815,10 @@ namespace vtil::symbolic
 					//
 					cache_value* value = it->get( &cache_value::lru_key );
 					if ( value->lock_count <= 0 )
+					{
+						VTIL_SYMEX_COUNT( cache_evictions );
 						erase( value );
+					}
 					it = next;
 				}
 			}
@@ -341,29 +853,56 @@ namespace vtil::symbolic
 		//
 		std::tuple<expression::reference&, bool&, bool, cache_value*> lookup( const expression::reference& exp )
 		{
-			// Signal signature matcher.
-			//
-			cache_scanner::sigscan_result sig_search = { exp };
-			cache_scanner::sigscan = exp->depth > VTIL_SYMEX_SELFGEN_SIGMATCH_DEPTH_LIM ? &sig_search : nullptr;
-
 			// Make sure we don't rehash and then emplace/find.
 			//
 			fassert( ( map.max_load_factor() * map.bucket_count() ) >= ( map.size() + 1 ) );
-			auto [it, inserted] = map.emplace( exp, make_default<cache_value>() );
-			cache_scanner::sigscan = nullptr;
+			auto [it, inserted] = map.try_emplace( exp );
+
+			// If the entry is partial and not in use, discard it and simplify again as a new entry
+			// so that it is linked to the speculative queue and the signature index as such.
+			//
+			if ( !inserted && it->second.is_partial && it->second.lock_count <= 0 )
+			{
+				erase( &it->second );
+				std::tie( it, inserted ) = map.try_emplace( exp );
+			}
 
 			// Speculatively lock the entry.
 			//
 			it->second.lock_count++;
 
+			// If the entry is partial but in use, discard the result in place and simplify again.
+			//
+			if ( !inserted && it->second.is_partial )
+			{
+				VTIL_SYMEX_COUNT( cache_misses );
+				it->second.result = {};
+				it->second.is_simplified = false;
+				it->second.is_partial = false;
+				it->second.lock_count--;
+				if ( is_speculative && !it->second.spec_key.is_valid() )
+					spec_queue.emplace_back( &it->second.spec_key );
+				lru_queue.erase( &it->second.lru_key );
+				lru_queue.emplace_back( &it->second.lru_key );
+				return { it->second.result, it->second.is_simplified, false, &it->second };
+			}
+
 			// If we inserted a new entry:
 			//
 			if ( inserted )
 			{
+				// If past the depth limit, look for a structurally equivalent entry.
+				//
+				auto [base, table] = it->first->depth > VTIL_SYMEX_SELFGEN_SIGMATCH_DEPTH_LIM 
+					? match_signature( it->first ) 
+					: std::pair<cache_value*, expression::uid_relation_table>{};
+
 				// If there is a partial match:
 				//
-				if ( auto base = sig_search.match )
+				if ( base )
 				{
+					VTIL_SYMEX_COUNT( cache_signature_hits );
+
 					// Reset inserted flag.
 					//
 					inserted = false;
@@ -372,11 +911,11 @@ namespace vtil::symbolic
 					//
 					if ( base->is_simplified )
 					{
-						it->second.result = make_const( base->result ).transform( [ &sig_search ] ( expression::delegate& exp )
+						it->second.result = make_const( base->result ).transform( [ &table = table ] ( expression::delegate& exp )
 						{
 							if ( !exp->is_variable() )
 								return;
-							for ( auto& [a, b] : sig_search.table )
+							for ( auto& [a, b] : table )
 							{
 								if ( exp->is_identical( *a ) )
 								{
@@ -407,6 +946,10 @@ namespace vtil::symbolic
 						lru_queue.emplace_front( &base->lru_key );
 					}
 				}
+				else
+				{
+					VTIL_SYMEX_COUNT( cache_misses );
+				}
 
 				// Initialize it.
 				//
@@ -414,6 +957,7 @@ namespace vtil::symbolic
 			}
 			else
 			{
+				VTIL_SYMEX_COUNT( cache_hits );
 				lru_queue.erase( &it->second.lru_key );
 			}
 
@@ -428,6 +972,191 @@ namespace vtil::symbolic
 		}
 	};
 
+	// Simplifier cache shared between threads, acts as the second level behind the thread local 
+	// state and only stores the results of non-speculative simplifications that ran to completion.
+	//
+	struct shared_simplifier_cache
+	{
+		static constexpr size_t shard_count = VTIL_SYMEX_SHARED_CACHE_SHARDS;
+
+		struct cache_value
+		{
+			expression::reference result;
+			bool is_simplified;
+		};
+
+		// Entries carry a reference bit set on every hit, which gives them a second chance when 
+		// the shard is pruned.
+		//
+		struct cache_entry : cache_value
+		{
+			mutable std::atomic<bool> referenced = false;
+			cache_entry( const expression::reference& result, bool is_simplified ) : cache_value{ result, is_simplified } {}
+		};
+		using cache_map = std::unordered_map<expression::reference, cache_entry, expression::reference::hasher, expression::reference::if_identical>;
+
+		// Each shard has its own lock and counters to avoid contention, as well as the keys in
+		// insertion order to be pruned from the front.
+		//
+		struct shard
+		{
+			std::shared_mutex mtx;
+			cache_map map;
+			std::deque<const expression::reference*> order;
+
+			std::atomic<size_t> hits = 0;
+			std::atomic<size_t> misses = 0;
+			std::atomic<size_t> insertions = 0;
+			std::atomic<size_t> evictions = 0;
+		};
+		shard shards[ shard_count ];
+
+		// Maximum number of entries, zero disables the cache.
+		//
+		std::atomic<size_t> limit = VTIL_SYMEX_SHARED_CACHE_SIZE;
+
+		shard& get_shard( const expression::reference& exp ) { return shards[ ( exp->hash().as64() >> 32 ) % shard_count ]; }
+
+		// Looks up the cache for the expression.
+		//
+		std::optional<cache_value> lookup( const expression::reference& exp )
+		{
+			if ( !limit.load( std::memory_order::relaxed ) )
+				return std::nullopt;
+
+			auto& shard = get_shard( exp );
+			std::shared_lock _g{ shard.mtx };
+			if ( auto it = shard.map.find( exp ); it != shard.map.end() )
+			{
+				shard.hits.fetch_add( 1, std::memory_order::relaxed );
+				if ( !it->second.referenced.load( std::memory_order::relaxed ) )
+					it->second.referenced.store( true, std::memory_order::relaxed );
+				return it->second;
+			}
+			shard.misses.fetch_add( 1, std::memory_order::relaxed );
+			return std::nullopt;
+		}
+
+		// Inserts a completed entry into the cache, pruning the shard if it is full.
+		//
+		void insert( const expression::reference& exp, const expression::reference& result, bool is_simplified )
+		{
+			size_t shard_limit = limit.load( std::memory_order::relaxed ) / shard_count;
+			if ( !shard_limit )
+				return;
+
+			auto& shard = get_shard( exp );
+			std::unique_lock _g{ shard.mtx };
+			if ( shard.map.size() >= shard_limit )
+			{
+				// Evict the oldest entries, moving the ones that were hit since they were last 
+				// considered to the back of the queue instead.
+				//
+				size_t prune_count = std::max<size_t>( 1, ( size_t ) ( shard_limit * VTIL_SYMEX_LRU_PRUNE_COEFF ) );
+				size_t evicted = 0;
+				while ( evicted != prune_count && !shard.order.empty() )
+				{
+					auto it = shard.map.find( *shard.order.front() );
+					shard.order.pop_front();
+					if ( it->second.referenced.exchange( false, std::memory_order::relaxed ) )
+					{
+						shard.order.push_back( &it->first );
+						continue;
+					}
+					shard.map.erase( it );
+					evicted++;
+				}
+				shard.evictions.fetch_add( evicted, std::memory_order::relaxed );
+			}
+			if ( auto [it, inserted] = shard.map.try_emplace( exp, result, is_simplified ); inserted )
+			{
+				shard.order.push_back( &it->first );
+				shard.insertions.fetch_add( 1, std::memory_order::relaxed );
+			}
+		}
+
+		// Resets the cache.
+		//
+		void reset()
+		{
+			for ( auto& shard : shards )
+			{
+				std::unique_lock _g{ shard.mtx };
+				shard.order.clear();
+				shard.map.clear();
+			}
+		}
+	};
+
+	// Cache is intentionally leaked to avoid destruction order issues with the object pool.
+	//
+	static shared_simplifier_cache& get_shared_cache()
+	{
+		static shared_simplifier_cache* cache = new shared_simplifier_cache();
+		return *cache;
+	}
+
+	void purge_shared_simplifier_cache() { get_shared_cache().reset(); }
+	size_t set_shared_simplifier_cache_limit( size_t n ) { return get_shared_cache().limit.exchange( VTIL_SHARED_REFERENCE_ATOMIC ? n : 0 ); }
+	shared_cache_statistics get_shared_simplifier_cache_statistics()
+	{
+		shared_cache_statistics result = {};
+		for ( auto& shard : get_shared_cache().shards )
+		{
+			{
+				std::shared_lock _g{ shard.mtx };
+				result.size += shard.map.size();
+			}
+			result.hits +=       shard.hits.load( std::memory_order::relaxed );
+			result.misses +=     shard.misses.load( std::memory_order::relaxed );
+			result.insertions += shard.insertions.load( std::memory_order::relaxed );
+			result.evictions +=  shard.evictions.load( std::memory_order::relaxed );
+		}
+		return result;
+	}
+	void enum_shared_simplifier_cache( function_view<void( const expression::reference& exp, const expression::reference& result, bool is_simplified )> fn )
+	{
+		// Copy each shard before invoking the callback so that it can access the cache.
+		//
+		std::vector<std::pair<expression::reference, shared_simplifier_cache::cache_value>> entries;
+		for ( auto& shard : get_shared_cache().shards )
+		{
+			{
+				std::shared_lock _g{ shard.mtx };
+				entries.assign( shard.map.begin(), shard.map.end() );
+			}
+			for ( auto& [exp, value] : entries )
+				fn( exp, value.result, value.is_simplified );
+		}
+	}
+	void insert_shared_simplifier_cache( const expression::reference& exp, const expression::reference& result, bool is_simplified )
+	{
+		get_shared_cache().insert( exp, result, is_simplified );
+	}
+	hash_t get_directive_table_hash()
+	{
+		static const hash_t hash = [ ] ()
+		{
+			// Hash the textual form of every directive in the order they are matched.
+			//
+			hash_t hash = {};
+			auto hash_table = [ & ] ( const auto& table )
+			{
+				hash = combine_hash( hash, make_hash( std::size( table ) ) );
+				for ( auto& [from, to] : table )
+					hash = combine_hash( hash, make_hash( from.to_string(), to.to_string() ) );
+			};
+			hash_table( directive::universal_simplifiers );
+			hash_table( directive::build_boolean_simplifiers() );
+			hash_table( directive::boolean_joiners );
+			hash_table( directive::join_descriptors );
+			hash_table( directive::pack_descriptors );
+			hash_table( directive::unpack_descriptors );
+			return hash;
+		}();
+		return hash;
+	}
+
 	static task_local( simplifier_state ) local_state;
 	void purge_simplifier_state() { if( local_state.init ) local_state->reset(); }
 
@@ -484,11 +1213,11 @@ namespace vtil::symbolic
 		
 		// Enumerate each pack descriptor:
 		//
-		for ( auto [dir_src, dir_dst] : get_pack_descriptors( exp->op )  )
+		for ( auto [dir_src, dir_dst] : get_pack_descriptors( *exp )  )
 		{
 			// If we can transform the expression by the directive set:
 			//
-			if ( auto exp_new = transform( exp, dir_src, dir_dst ) )
+			if ( auto exp_new = transform_counted( exp, dir_src, dir_dst ) )
 			{
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
 				log<CON_PRP>( "[Pack] %s => %s\n", *dir_src, *dir_dst );
@@ -601,10 +1330,16 @@ namespace vtil::symbolic
 		//
 		if ( lstate.scope.size() >= lstate.max_depth )
 		{
+			VTIL_SYMEX_COUNT( depth_limit_bailouts );
 			lstate.max_depth = 0;
 			return false;
 		}
 
+		// If we've exhausted the budget, recursively fail.
+		//
+		if ( local_budget.exhausted )
+			return false;
+
 		// Clear lazy if not done.
 		//
 		if ( exp->is_lazy )
@@ -669,6 +1404,33 @@ namespace vtil::symbolic
 			return false;
 		}
 
+		// Lookup the shared cache if the expression is not trivial to simplify, if not found, publish 
+		// the result once complete unless it was computed speculatively since it may be incomplete.
+		//
+		auto& shared_cache = get_shared_cache();
+		bool is_shared = exp->depth >= VTIL_SYMEX_SHARED_CACHE_MIN_DEPTH;
+		if ( auto shared_entry = is_shared ? shared_cache.lookup( exp ) : std::nullopt )
+		{
+			cache_entry = std::move( shared_entry->result );
+			success_flag = shared_entry->is_simplified;
+			if ( cache_entry && success_flag )
+			{
+#if VTIL_SYMEX_SIMPLIFY_VERBOSE
+				log<CON_YLW>( "= %s (From shared cache)\n", *cache_entry );
+#endif
+				exp = cache_entry;
+				return true;
+			}
+			return false;
+		}
+		finally _p( [ &, key = is_shared ? exp : expression::reference{} ] ()
+		{
+			if ( local_budget.exhausted )
+				entry->is_partial = true;
+			else if ( is_shared && !lstate.is_speculative )
+				shared_cache.insert( key, entry->result, entry->is_simplified );
+		} );
+
 		// If trying to simplify resizing:
 		//
 		if ( exp->op == math::operator_id::ucast ||
@@ -780,11 +1542,11 @@ namespace vtil::symbolic
 
 		// Enumerate each universal simplifier:
 		//
-		for ( auto& [dir_src, dir_dst] : get_universal_simplifiers( exp->op ) )
+		for ( auto& [dir_src, dir_dst] : get_universal_simplifiers( *exp ) )
 		{
 			// If we can transform the expression by the directive set:
 			//
-			if ( auto exp_new = transform( exp, dir_src, dir_dst ) )
+			if ( auto exp_new = transform_counted( exp, dir_src, dir_dst ) )
 			{
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
 				log<CON_GRN>( "[Simplify] %s => %s\n", *dir_src, *dir_dst );
@@ -807,11 +1569,11 @@ namespace vtil::symbolic
 		{
 			// Enumerate each universal simplifier:
 			//
-			for ( auto& [dir_src, dir_dst] : get_boolean_simplifiers( exp->op ) )
+			for ( auto& [dir_src, dir_dst] : get_boolean_simplifiers( *exp ) )
 			{
 				// If we can transform the expression by the directive set:
 				//
-				if ( auto exp_new = transform( exp, dir_src, dir_dst ) )
+				if ( auto exp_new = transform_counted( exp, dir_src, dir_dst ) )
 				{
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
 					log<CON_GRN>( "[Simplify] %s => %s\n", *dir_src, *dir_dst );
@@ -853,6 +1615,7 @@ namespace vtil::symbolic
 				//
 				if ( lstate.max_depth == 0 )
 				{
+					VTIL_SYMEX_COUNT( join_bailouts );
 					lstate.trash_speculative();
 					lstate.scope = pscope;
 					lstate.scope.tail->next = nullptr;
@@ -883,11 +1646,11 @@ namespace vtil::symbolic
 
 		// Enumerate each join descriptor:
 		//
-		for ( auto& [dir_src, dir_dst] : get_join_descriptors( exp->op ) )
+		for ( auto& [dir_src, dir_dst] : get_join_descriptors( *exp ) )
 		{
 			// If we can transform the expression by the directive set:
 			//
-			if ( auto exp_new = transform( exp, dir_src, dir_dst, filter ) )
+			if ( auto exp_new = transform_counted( exp, dir_src, dir_dst, filter ) )
 			{
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
 				log<CON_GRN>( "[Join] %s => %s\n", *dir_src, *dir_dst );
@@ -911,11 +1674,11 @@ namespace vtil::symbolic
 		{
 			// Enumerate each join descriptor:
 			//
-			for ( auto& [dir_src, dir_dst] : get_boolean_joiners( exp->op ) )
+			for ( auto& [dir_src, dir_dst] : get_boolean_joiners( *exp ) )
 			{
 				// If we can transform the expression by the directive set:
 				//
-				if ( auto exp_new = transform( exp, dir_src, dir_dst, filter ) )
+				if ( auto exp_new = transform_counted( exp, dir_src, dir_dst, filter ) )
 				{
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
 					log<CON_GRN>( "[Join] %s => %s\n", *dir_src, *dir_dst );
@@ -940,11 +1703,11 @@ namespace vtil::symbolic
 		{
 			// Enumerate each unpack descriptor:
 			//
-			for ( auto& [dir_src, dir_dst] : get_unpack_descriptors( exp->op ) )
+			for ( auto& [dir_src, dir_dst] : get_unpack_descriptors( *exp ) )
 			{
 				// If we can transform the expression by the directive set:
 				//
-				if ( auto exp_new = transform( exp, dir_src, dir_dst,
+				if ( auto exp_new = transform_counted( exp, dir_src, dir_dst,
 					 [ & ] ( auto& exp_new ) { simplify_expression( exp_new, true ); return exp_new->complexity < exp->complexity; } ) )
 				{
 #if VTIL_SYMEX_SIMPLIFY_VERBOSE
@@ -976,10 +1739,337 @@ namespace vtil::symbolic
 		return false;
 	}
 
+	// Simplifies the independent subtrees of a large expression on worker threads and replaces
+	// them with their simplified forms, the expression itself is left to the caller. Workers
+	// consume the budget of the current simplification which must already be started. Returns
+	// [<simplified?>, <exhausted budget?>].
+	//
+	static std::pair<bool, bool> simplify_subtrees_parallel( expression::reference& exp, bool unpack, size_t worker_count )
+	{
+		// Disallow splitting the nested simplifications.
+		//
+		local_worker_count = 1;
+		finally _w( [ & ] () { local_worker_count = worker_count; } );
+
+		// Split the deepest subtree into its operands until there are enough subtrees to keep
+		// the workers busy, saving the expressions that were split.
+		//
+		std::vector<expression::reference> subtrees = { exp };
+		std::unordered_set<const expression*> split;
+		while ( subtrees.size() < ( worker_count * VTIL_SYMEX_PARALLEL_SPLIT_FACTOR ) )
+		{
+			auto it = std::max_element( subtrees.begin(), subtrees.end(), [ ] ( auto& a, auto& b ) { return a->depth < b->depth; } );
+			if ( !( *it )->is_expression() || ( *it )->simplify_hint || ( *it )->depth < VTIL_SYMEX_PARALLEL_SPLIT_DEPTH )
+				break;
+
+			expression::reference node = std::move( *it );
+			subtrees.erase( it );
+			split.insert( node.get() );
+			for ( auto* op : { &node->lhs, &node->rhs } )
+			{
+				if ( !op->is_valid() || !( *op )->is_expression() || ( *op )->simplify_hint )
+					continue;
+				if ( std::find_if( subtrees.begin(), subtrees.end(), [ & ] ( auto& e ) { return e.is_identical( **op ); } ) == subtrees.end() )
+					subtrees.push_back( *op );
+			}
+		}
+		if ( subtrees.size() < 2 )
+			return { false, false };
+
+		// Share the remaining budget with the workers and with any simplification the replacement
+		// of the operands causes, the attempts are then carried over to the current thread.
+		//
+		std::atomic<size_t> attempts = local_budget.attempts;
+		local_budget.shared_attempts = &attempts;
+		finally _a( [ & ] ()
+		{
+			local_budget.shared_attempts = nullptr;
+			local_budget.attempts = attempts.load();
+		} );
+
+		// Simplify the subtrees as a batch.
+		//
+		std::vector<expression::reference> results = subtrees;
+		simplify_expressions( results, false, unpack, worker_count );
+
+		std::unordered_map<const expression*, size_t> indices;
+		for ( size_t i = 0; i != subtrees.size(); i++ )
+			indices.emplace( subtrees[ i ].get(), i );
+
+		// Replace the subtrees within the expressions that were split, bottom-up.
+		//
+		auto replace_operands = [ & ] ( auto&& self, expression::reference& exp ) -> void
+		{
+			expression* exp_new = nullptr;
+			for ( auto op_ptr : { &expression::lhs, &expression::rhs } )
+			{
+				const expression::reference& op = exp.get()->*op_ptr;
+				if ( !op.is_valid() )
+					continue;
+
+				expression::reference op_ref;
+				if ( auto it = indices.find( op.get() ); it != indices.end() )
+				{
+					op_ref = results[ it->second ];
+				}
+				else if ( split.contains( op.get() ) )
+				{
+					op_ref = op;
+					self( self, op_ref );
+				}
+				else
+				{
+					continue;
+				}
+
+				if ( op_ref != op )
+				{
+					if ( !exp_new ) exp_new = +exp;
+					exp_new->*op_ptr = std::move( op_ref );
+				}
+			}
+			if ( exp_new )
+				exp_new->update( false );
+		};
+		expression::reference exp_new = exp;
+		replace_operands( replace_operands, exp_new );
+		bool simplified = exp_new.get() != exp.get();
+		exp = std::move( exp_new );
+		return { simplified, local_budget.exhausted };
+	}
+
+	// Replaces the simplified expression with its canonical instance at the top level.
+	//
+	void intern_simplified( expression::reference& exp )
+	{
+		if ( local_state.init && !local_state->scope.empty() )
+			return;
+		if ( exp.is_valid() && !exp.is_temporary() && is_interning_enabled() )
+			intern( exp );
+	}
+
 	// Simple routine wrapping real simplification to instrument it for any reason when needed.
 	//
-	bool simplify_expression( expression::reference& exp, bool pretty, bool unpack )
+	bool simplify_expression( expression::reference& exp, bool pretty, bool unpack, simplifier_engine engine )
+	{
+		// Redirect to the equality saturation engine if requested.
+		//
+		if ( engine == simplifier_engine::egraph )
+		{
+			bool result = simplify_expression_egraph( exp, pretty, unpack );
+			intern_simplified( exp );
+			return result;
+		}
+
+		// If this is a nested call, simplify as is.
+		//
+		if ( !local_state->scope.empty() )
+			return simplify_expression_i( exp, pretty, unpack );
+
+		// Start a new budget unless this simplification is a part of a split one whose budget
+		// is shared between the workers.
+		//
+		if ( !local_budget.shared_attempts )
+			local_budget.begin();
+
+		// If multiple workers are allowed, simplify the independent subtrees of large expressions
+		// concurrently first.
+		//
+		auto [split_simplified, split_exhausted] = local_worker_count > 1 
+			? simplify_subtrees_parallel( exp, unpack, local_worker_count ) 
+			: std::pair{ false, false };
+
+		// If the budget is exhausted, mark the result as simplified so that the callers do not
+		// attempt to simplify it again, owning it first so that the other references to the
+		// input are not affected.
+		//
+		local_budget.exhausted |= split_exhausted;
+		bool result = simplify_expression_i( exp, pretty, unpack ) || split_simplified;
+		if ( local_budget.exhausted )
+		{
+			if ( exp->is_expression() )
+				( +exp )->simplify_hint = true;
+			return result;
+		}
+
+		// Replace the result with the canonical instance.
+		//
+		intern_simplified( exp );
+		return result;
+	}
+	bool simplify_expression( expression::reference& exp, const simplifier_budget& budget, bool pretty, bool unpack )
+	{
+		simplifier_budget prev = set_simplifier_budget( budget );
+		finally _r( [ & ] () { set_simplifier_budget( prev ); } );
+		return simplify_expression( exp, pretty, unpack );
+	}
+
+	// Sets the budget of the simplifications on the current thread, returns the previous budget.
+	//
+	simplifier_budget set_simplifier_budget( const simplifier_budget& budget )
+	{
+		return std::exchange( local_budget.limit, budget );
+	}
+
+	// Returns whether the last top level simplification on the current thread exhausted its budget.
+	//
+	bool is_simplifier_budget_exhausted()
+	{
+		return local_budget.exhausted;
+	}
+
+	// Returns the number of directive attempts made by the last top level simplification on the
+	// current thread, including the attempts of its workers.
+	//
+	size_t get_simplifier_attempt_count()
 	{
-		return simplify_expression_i( exp, pretty, unpack );
+		return local_budget.attempts;
+	}
+
+	// Sets the number of workers a single top level simplification on the current thread can use, 
+	// returns the previous value.
+	//
+	size_t set_simplifier_worker_count( size_t n )
+	{
+		return std::exchange( local_worker_count, std::max<size_t>( n, 1 ) );
+	}
+
+	// Simplifies a batch of expressions on the current thread.
+	//
+	static size_t simplify_expressions_i( std::span<expression::reference> exps, bool pretty, bool unpack )
+	{
+		// Map each unique subtree to its simplified form.
+		//
+		std::unordered_map<expression::reference, expression::reference, 
+			expression::reference::hasher, expression::reference::if_identical> results;
+
+		// Replaces the operands of the expression with their simplified forms, visiting each unique subtree once.
+		//
+		auto simplify_operands = [ & ] ( auto&& self, expression::reference& exp ) -> void
+		{
+			expression* exp_new = nullptr;
+			for ( auto op_ptr : { &expression::lhs, &expression::rhs } )
+			{
+				const expression::reference& op = exp.get()->*op_ptr;
+				// If invalid, not an expression or is simplified, skip.
+				//
+				if ( !op.is_valid() || !op->is_expression() || op->simplify_hint )
+					continue;
+
+				// Lookup the subtree, if not visited yet simplify it bottom-up and save the result.
+				//
+				expression::reference op_ref;
+				if ( auto it = results.find( op ); it != results.end() )
+				{
+					op_ref = it->second;
+				}
+				else
+				{
+					op_ref = op;
+					self( self, op_ref );
+					simplify_expression( op_ref, false );
+					results.emplace( op, op_ref );
+				}
+
+				// If changed, own the expression and replace the operand.
+				//
+				if ( op_ref != op )
+				{
+					if ( !exp_new ) exp_new = +exp;
+					exp_new->*op_ptr = std::move( op_ref );
+				}
+			}
+
+			// Update the expression if any of the operands were replaced.
+			//
+			if ( exp_new )
+				exp_new->update( false );
+		};
+
+		// Simplify each root with the operands replaced.
+		//
+		size_t count = 0;
+		bool exhausted = false;
+		for ( auto& exp : exps )
+		{
+			// Skip null references.
+			//
+			if ( !exp )
+				continue;
+
+			if ( !exp->is_expression() || exp->simplify_hint )
+			{
+				count += simplify_expression( exp, pretty, unpack );
+				exhausted |= local_budget.exhausted;
+				continue;
+			}
+
+			expression::reference exp_new = exp;
+			simplify_operands( simplify_operands, exp_new );
+			bool simplified = simplify_expression( exp_new, pretty, unpack );
+			if ( simplified || exp_new != exp )
+				count++;
+			exp = std::move( exp_new );
+			exhausted |= local_budget.exhausted;
+		}
+
+		// Report the budget as exhausted if any of the expressions exhausted it.
+		//
+		local_budget.exhausted = exhausted;
+		return count;
+	}
+
+	// Simplifies a batch of expressions, subtrees shared between the expressions are simplified
+	// only once. If more than one worker is requested, roots are distributed between worker
+	// threads. Returns the number of expressions that were simplified.
+	//
+	size_t simplify_expressions( std::span<expression::reference> exps, bool pretty, bool unpack, size_t worker_count )
+	{
+		// If there is only a single worker or not enough roots to split, simplify on the current thread.
+		//
+		worker_count = std::min( worker_count, exps.size() );
+		if ( worker_count <= 1 )
+			return simplify_expressions_i( exps, pretty, unpack );
+
+		// Split the roots into contiguous chunks, subtrees shared between the chunks will be 
+		// resolved through the shared cache.
+		//
+		std::vector<std::span<expression::reference>> chunks;
+		size_t chunk_size = ( exps.size() + worker_count - 1 ) / worker_count;
+		for ( size_t i = 0; i < exps.size(); i += chunk_size )
+			chunks.emplace_back( exps.subspan( i, std::min( chunk_size, exps.size() - i ) ) );
+
+		// Simplify each chunk with the budget of the current thread, the caches of the worker
+		// threads are merged into the cache of the current thread once complete. If the budget
+		// is shared, workers inherit its deadline and counter as well.
+		//
+		simplifier_state* owner = &*local_state;
+		simplifier_budget_state budget = local_budget;
+		std::mutex states_mutex;
+		std::vector<simplifier_state_ptr> states;
+		std::atomic<size_t> count = 0;
+		std::atomic<bool> exhausted = false;
+		transform_parallel( chunks, [ & ] ( std::span<expression::reference> chunk )
+		{
+			// Disallow splitting the simplifications on the workers.
+			//
+			size_t prev_workers = std::exchange( local_worker_count, 1 );
+			simplifier_budget_state prev = std::exchange( local_budget, budget );
+			count += simplify_expressions_i( chunk, pretty, unpack );
+			if ( local_budget.exhausted )
+				exhausted = true;
+			local_budget = prev;
+			local_worker_count = prev_workers;
+
+			if ( &*local_state != owner )
+			{
+				std::lock_guard _g( states_mutex );
+				states.emplace_back( swap_simplifier_state() );
+			}
+		} );
+		for ( auto& state : states )
+			local_state->merge( *state );
+		local_budget.exhausted = exhausted;
+		return count;
 	}
 };
\ No newline at end of file
@@ -29,6 +29,11 @@
 #include <iterator>
 #include <unordered_map>
 #include <memory>
+#include <vector>
+#include <span>
+#include <string>
+#include <chrono>
+#include <vtil/utility>
 #include "../expressions/expression.hpp"
 
 // [Configuration]
@@ -38,6 +43,33 @@
 	#define VTIL_SYMEX_SIMPLIFY_VERBOSE 0
 #endif
 
+// [Configuration]
+// Determine whether we should collect statistics of the simplification process.
+//
+#ifndef VTIL_SYMEX_SIMPLIFY_STATISTICS
+	#define VTIL_SYMEX_SIMPLIFY_STATISTICS 0
+#endif
+
+// [Configuration]
+// Determine the default budget of a single simplification, once either the number of
+// directive attempts or the time limit is exhausted the best expression found so far is
+// returned. Zero disables the limit.
+//
+#ifndef VTIL_SYMEX_SIMPLIFY_ATTEMPT_LIMIT
+	#define VTIL_SYMEX_SIMPLIFY_ATTEMPT_LIMIT 0
+#endif
+#ifndef VTIL_SYMEX_SIMPLIFY_TIME_LIMIT_US
+	#define VTIL_SYMEX_SIMPLIFY_TIME_LIMIT_US 0
+#endif
+
+// [Configuration]
+// Determine the default number of workers a single simplification can use, if more than one
+// the independent subtrees of large expressions are simplified concurrently.
+//
+#ifndef VTIL_SYMEX_SIMPLIFY_WORKERS
+	#define VTIL_SYMEX_SIMPLIFY_WORKERS 1
+#endif
+
 namespace vtil::symbolic
 {
 	struct simplifier_state;
@@ -54,10 +86,64 @@ namespace vtil::symbolic
 		simplifier_state_ptr operator()() const noexcept;
 	};
 
+	// Engines the simplifier can use.
+	//
+	enum class simplifier_engine
+	{
+		// Applies the first directive that reduces the complexity of the expression.
+		//
+		greedy,
+
+		// Explores all rewrites by equality saturation within a budget and extracts the least complex term.
+		//
+		egraph,
+	};
+
+	// Budget of a single top level simplification, zero disables the limit.
+	//
+	struct simplifier_budget
+	{
+		size_t attempt_limit = VTIL_SYMEX_SIMPLIFY_ATTEMPT_LIMIT;
+		std::chrono::microseconds time_limit = std::chrono::microseconds{ VTIL_SYMEX_SIMPLIFY_TIME_LIMIT_US };
+	};
+
 	// Attempts to simplify the expression given, returns whether the simplification
-	// succeeded or not.
+	// succeeded or not. If the budget is exhausted, the best expression found so far is
+	// returned with the simplify hint set so that it is not simplified again.
+	//
+	bool simplify_expression( expression::reference& exp, bool pretty = false, bool unpack = true, simplifier_engine engine = simplifier_engine::greedy );
+	bool simplify_expression( expression::reference& exp, const simplifier_budget& budget, bool pretty = false, bool unpack = true );
+
+	// Replaces the simplified expression with its canonical instance if interning is enabled. This
+	// is only done at the top level, never within a nested simplification or for temporary references,
+	// so that every entry point yields the same canonical nodes.
+	//
+	void intern_simplified( expression::reference& exp );
+
+	// Sets the budget of the simplifications on the current thread, returns the previous budget.
+	//
+	simplifier_budget set_simplifier_budget( const simplifier_budget& budget );
+
+	// Returns whether the last top level simplification on the current thread exhausted its budget.
+	//
+	bool is_simplifier_budget_exhausted();
+
+	// Returns the number of directive attempts made by the last top level simplification on the
+	// current thread, including the attempts of its workers.
+	//
+	size_t get_simplifier_attempt_count();
+
+	// Sets the number of workers a single top level simplification on the current thread can use,
+	// returns the previous value. If more than one, the independent subtrees of large expressions
+	// are simplified concurrently and the caches of the workers are merged into the current thread's.
 	//
-	bool simplify_expression( expression::reference& exp, bool pretty = false, bool unpack = true );
+	size_t set_simplifier_worker_count( size_t n );
+
+	// Simplifies a batch of expressions, subtrees shared between the expressions are simplified
+	// only once. If more than one worker is requested, roots are distributed between worker
+	// threads. Returns the number of expressions that were simplified.
+	//
+	size_t simplify_expressions( std::span<expression::reference> exps, bool pretty = false, bool unpack = true, size_t worker_count = 1 );
 
 	// Purges the current thread's simplifier cache.
 	//
@@ -66,4 +152,86 @@ namespace vtil::symbolic
 	// Swaps the current thread's simplifier cache.
 	//
 	simplifier_state_ptr swap_simplifier_state( simplifier_state_ptr p = nullptr );
+
+	// Statistics of the simplifier cache shared between threads.
+	//
+	struct shared_cache_statistics
+	{
+		size_t size;
+		size_t hits;
+		size_t misses;
+		size_t insertions;
+		size_t evictions;
+	};
+
+	// Purges the simplifier cache shared between threads.
+	//
+	void purge_shared_simplifier_cache();
+
+	// Sets the maximum number of entries in the shared cache, zero disables it. Returns the previous limit.
+	// The cache stays disabled if references are thread-confined.
+	//
+	size_t set_shared_simplifier_cache_limit( size_t n );
+
+	// Returns the statistics of the shared cache.
+	//
+	shared_cache_statistics get_shared_simplifier_cache_statistics();
+
+	// Enumerates the entries of the shared cache, used to persist the cache.
+	//
+	void enum_shared_simplifier_cache( function_view<void( const expression::reference& exp, const expression::reference& result, bool is_simplified )> fn );
+
+	// Inserts an entry into the shared cache, used to restore a persisted cache.
+	//
+	void insert_shared_simplifier_cache( const expression::reference& exp, const expression::reference& result, bool is_simplified );
+
+	// Returns the hash of the directive tables the simplifier is built with, a persisted
+	// cache created with a different hash is stale.
+	//
+	hash_t get_directive_table_hash();
+
+	// Statistics of a single directive.
+	//
+	struct directive_statistics
+	{
+		const char* table;
+		size_t index;
+		std::string source;
+		std::string target;
+		size_t attempts;
+		size_t successes;
+		uint64_t time_ns;
+	};
+
+	// Statistics of the simplifier merged from all threads, counters are only collected
+	// if VTIL_SYMEX_SIMPLIFY_STATISTICS is set.
+	//
+	struct simplifier_statistics
+	{
+		size_t cache_hits;
+		size_t cache_misses;
+		size_t cache_signature_hits;
+		size_t cache_prunes;
+		size_t cache_evictions;
+		size_t depth_limit_bailouts;
+		size_t join_bailouts;
+		size_t budget_bailouts;
+		shared_cache_statistics shared_cache;
+
+		// Directives that were attempted at least once, in the order they are matched.
+		//
+		std::vector<directive_statistics> directives;
+
+		// Conversion to JSON.
+		//
+		std::string to_json() const;
+	};
+
+	// Returns the statistics of the simplifier.
+	//
+	simplifier_statistics get_simplifier_statistics();
+
+	// Resets the statistics of the simplifier.
+	//
+	void reset_simplifier_statistics();
 };
\ No newline at end of file
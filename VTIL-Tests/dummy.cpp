@@ -91,6 +91,822 @@ DOCTEST_TEST_CASE("Expression hash")
     }
 }
 
+DOCTEST_TEST_CASE("Expression interning")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    bool prev = vtil::symbolic::set_interning( true );
+
+    vtil::symbolic::expression::reference a = vtil::symbolic::variable{ vtil::REG_SP }.to_expression() + 8;
+    vtil::symbolic::expression::reference b = vtil::symbolic::variable{ vtil::REG_SP }.to_expression() + 4 + 4;
+    vtil::symbolic::expression::reference c = vtil::symbolic::variable{ vtil::REG_SP }.to_expression() + 9;
+    a.simplify();
+    b.simplify();
+    c.simplify();
+    CHECK( a.get() == b.get() );
+    CHECK( a->is_identical( *b ) );
+    CHECK( !a->is_identical( *c ) );
+    CHECK( vtil::symbolic::interning_table_size() != 0 );
+
+    vtil::symbolic::expression::reference d = vtil::symbolic::variable{ vtil::REG_SP }.to_expression() + 2 + 6;
+    vtil::symbolic::simplify_expression(d, false, true, vtil::symbolic::simplifier_engine::egraph);
+    CHECK( a.get() == d.get() );
+
+    vtil::symbolic::purge_interning_table();
+    CHECK( !a->is_interned );
+    CHECK( a->is_identical( *b ) );
+    vtil::symbolic::set_interning( prev );
+}
+
+DOCTEST_TEST_CASE("E-graph simplification")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    vtil::symbolic::expression::reference a = vtil::symbolic::expression{ vtil::symbolic::unique_identifier{ "a" }, 64 };
+    vtil::symbolic::expression::reference b = vtil::symbolic::expression{ vtil::symbolic::unique_identifier{ "b" }, 64 };
+    vtil::symbolic::expression::reference x = ((a | b) + (a & b)) - b;
+
+    vtil::symbolic::expression::reference greedy = x;
+    vtil::symbolic::expression::reference egraph = x;
+    vtil::symbolic::simplify_expression(greedy);
+    vtil::symbolic::simplify_expression(egraph, false, true, vtil::symbolic::simplifier_engine::egraph);
+    CHECK( egraph->complexity <= greedy->complexity );
+
+    for (uint64_t i = 1; i != 64; i++)
+    {
+        auto eval = [&](auto& exp) { return exp->evaluate([&](const vtil::symbolic::unique_identifier& uid) { return uid.to_string() == "a" ? i * 0x9E3779B97F4A7C15 : ~i; }).known_one(); };
+        CHECK( eval(x) == eval(egraph) );
+    }
+}
+
+DOCTEST_TEST_CASE("Batch simplification")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+    expression::reference a = expression{ vtil::symbolic::unique_identifier{ "a" }, 64 };
+    expression::reference b = expression{ vtil::symbolic::unique_identifier{ "b" }, 64 };
+    expression::reference s = expression::make(expression::make(a, operator_id::bitwise_or, b), operator_id::subtract, expression::make(a, operator_id::bitwise_and, b));
+
+    std::vector<expression::reference> exps = {
+        expression::make(s, operator_id::bitwise_xor, expression::make(a, operator_id::bitwise_xor, b)),
+        expression::make(s, operator_id::add, expression{ 0, 64 }),
+        expression::make(expression::make(s, operator_id::bitwise_and, a), operator_id::bitwise_or, b),
+        expression::make(a, operator_id::add, b),
+    };
+
+    for (size_t workers : { 1, 2 })
+    {
+        auto batch = exps;
+        CHECK( vtil::symbolic::simplify_expressions(batch, false, true, workers) != 0 );
+        for (size_t i = 0; i != exps.size(); i++)
+            CHECK( batch[i]->equals(*std::as_const(exps[i]).simplify()) );
+    }
+
+    // Null references are left as is.
+    //
+    std::vector<expression::reference> sparse = { {}, exps[0], {} };
+    CHECK( vtil::symbolic::simplify_expressions(sparse, false, true, 1) == 1 );
+    CHECK( !sparse[0] );
+    CHECK( !sparse[2] );
+}
+
+// Wide XOR tree of independent subtrees.
+//
+static vtil::symbolic::expression::reference make_wide_xor_tree()
+{
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+
+    std::vector<expression::reference> parts;
+    for (int i = 0; i != 16; i++)
+    {
+        expression::reference a = expression{ vtil::symbolic::unique_identifier{ "a" + std::to_string(i) }, 64 };
+        expression::reference b = expression{ vtil::symbolic::unique_identifier{ "b" + std::to_string(i) }, 64 };
+        expression::reference k = expression::make(a, operator_id::bitwise_xor, expression{ 0x1337u + i, 64 });
+        expression::reference s = expression::make(expression::make(a, operator_id::bitwise_or, b), operator_id::subtract, expression::make(a, operator_id::bitwise_and, b));
+        parts.push_back(expression::make(expression::make(expression::make(s, operator_id::add, k), operator_id::subtract, k), operator_id::bitwise_xor, b));
+    }
+    while (parts.size() != 1)
+    {
+        for (size_t i = 0; i != parts.size() / 2; i++)
+            parts[i] = expression::make(parts[i * 2], operator_id::bitwise_xor, parts[i * 2 + 1]);
+        parts.resize(parts.size() / 2);
+    }
+    return parts[0];
+}
+
+DOCTEST_TEST_CASE("Parallel simplification")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+
+    expression::reference x = make_wide_xor_tree();
+    REQUIRE( x->depth >= 8 );
+
+    std::vector<expression::reference> results;
+    for (size_t workers : { 1, 4 })
+    {
+        vtil::symbolic::purge_simplifier_state();
+        vtil::symbolic::purge_shared_simplifier_cache();
+        size_t prev = vtil::symbolic::set_simplifier_worker_count(workers);
+        expression::reference y = x;
+        CHECK( vtil::symbolic::simplify_expression(y) );
+        vtil::symbolic::set_simplifier_worker_count(prev);
+        results.push_back(y);
+    }
+    CHECK( results[1]->complexity <= results[0]->complexity );
+
+    for (uint64_t i = 1; i != 64; i++)
+    {
+        auto eval = [&](auto& exp) { return exp->evaluate([&](const vtil::symbolic::unique_identifier& uid) { return vtil::make_hash(uid.to_string(), i).as64(); }).known_one(); };
+        CHECK( eval(x) == eval(results[0]) );
+        CHECK( eval(x) == eval(results[1]) );
+    }
+}
+
+DOCTEST_TEST_CASE("Shared simplifier cache eviction")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+
+    expression::reference a = expression{ vtil::symbolic::unique_identifier{ "a" }, 64 };
+    expression::reference b = expression{ vtil::symbolic::unique_identifier{ "b" }, 64 };
+    expression::reference c = expression{ vtil::symbolic::unique_identifier{ "c" }, 64 };
+    expression::reference hot = expression::make(expression::make(a, operator_id::add, b), operator_id::bitwise_xor, c);
+    expression::reference hot_result = expression::make(a, operator_id::bitwise_xor, c);
+
+    // Keep hitting one entry while filling the cache well past its limit, it should survive 
+    // along with the most recent entries.
+    //
+    vtil::symbolic::purge_simplifier_state();
+    vtil::symbolic::purge_shared_simplifier_cache();
+    size_t prev = vtil::symbolic::set_shared_simplifier_cache_limit(256);
+    auto stats = vtil::symbolic::get_shared_simplifier_cache_statistics();
+    vtil::symbolic::insert_shared_simplifier_cache(hot, hot_result, true);
+    for (uint64_t i = 0; i != 2048; i++)
+    {
+        expression::reference filler = expression::make(a, operator_id::add, expression{ i, 64 });
+        vtil::symbolic::insert_shared_simplifier_cache(filler, filler, false);
+
+        vtil::symbolic::purge_simplifier_state();
+        expression::reference y = hot;
+        CHECK( vtil::symbolic::simplify_expression(y) );
+        CHECK( y->is_identical(*hot_result) );
+    }
+    auto stats_new = vtil::symbolic::get_shared_simplifier_cache_statistics();
+    CHECK( stats_new.evictions != stats.evictions );
+    CHECK( stats_new.size <= 256 );
+
+    bool found = false;
+    size_t recent = 0;
+    vtil::symbolic::enum_shared_simplifier_cache([&](auto& exp, auto&, bool)
+    {
+        found |= exp->is_identical(*hot);
+        if (exp->op == operator_id::add && exp->rhs->is_constant() && *exp->rhs->get() >= (2048 - 16))
+            recent++;
+    });
+    CHECK( found );
+    CHECK( recent == 16 );
+
+    vtil::symbolic::set_shared_simplifier_cache_limit(prev);
+    vtil::symbolic::purge_shared_simplifier_cache();
+    vtil::symbolic::purge_simplifier_state();
+}
+
+DOCTEST_TEST_CASE("Lane-wise evaluation")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::math::operator_id;
+    constexpr size_t n = 16;
+    uint64_t lhs[n], rhs[n], sizes[n], out[n];
+    for (size_t i = 0; i != n; i++)
+    {
+        lhs[i] = i * 0x9E3779B97F4A7C15;
+        rhs[i] = (~i * 0x1337) | 1;
+        sizes[i] = 1 + (i * 7) % 64;
+    }
+
+    // Every operator must match the scalar evaluation, including the resizing ones.
+    //
+    for (uint8_t op = uint8_t(operator_id::bitwise_not); op != uint8_t(operator_id::max); op++)
+    {
+        operator_id id = operator_id(op);
+        bool unary = vtil::math::descriptor_of(id).operand_count == 1;
+        bool resize = id == operator_id::cast || id == operator_id::ucast;
+        for (auto [bcnt_lhs, bcnt_rhs] : { std::pair{ 64, 64 }, { 32, 32 }, { 8, 64 }, { 1, 8 } })
+        {
+            const uint64_t* vrhs = resize ? sizes : rhs;
+            vtil::math::evaluate_lanes(id, unary ? 0 : bcnt_lhs, unary ? nullptr : lhs, bcnt_rhs, vrhs, out, n);
+            for (size_t i = 0; i != n; i++)
+                CHECK( out[i] == vtil::math::evaluate(id, unary ? 0 : bcnt_lhs, unary ? 0 : lhs[i], bcnt_rhs, vrhs[i]).first );
+        }
+    }
+}
+
+DOCTEST_TEST_CASE("Min/max evaluation")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::math::operator_id;
+
+    // max/min compare as signed, umax/umin as unsigned, regardless of the operand size.
+    //
+    for (bitcnt_t bcnt : { 8, 16, 32 })
+    {
+        auto eval = [&](operator_id id, uint64_t a, uint64_t b) { return vtil::math::evaluate(id, bcnt, a, bcnt, b).first & vtil::math::fill(bcnt); };
+        uint64_t neg_one = vtil::math::fill(bcnt);
+        uint64_t int_min = 1ull << (bcnt - 1);
+        uint64_t int_max = int_min - 1;
+
+        CHECK( eval(operator_id::max_value, neg_one, 1) == 1 );
+        CHECK( eval(operator_id::min_value, neg_one, 1) == neg_one );
+        CHECK( eval(operator_id::umax_value, neg_one, 1) == neg_one );
+        CHECK( eval(operator_id::umin_value, neg_one, 1) == 1 );
+
+        CHECK( eval(operator_id::max_value, int_min, int_max) == int_max );
+        CHECK( eval(operator_id::min_value, int_min, int_max) == int_min );
+        CHECK( eval(operator_id::umax_value, int_min, int_max) == int_min );
+        CHECK( eval(operator_id::umin_value, int_min, int_max) == int_max );
+    }
+}
+
+DOCTEST_TEST_CASE("Compiled expression evaluation")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+    expression::reference a = expression{ vtil::symbolic::unique_identifier{ "a" }, 64 };
+    expression::reference b = expression{ vtil::symbolic::unique_identifier{ "b" }, 32 };
+    expression::reference x = ((a >> 3) ^ __ucast(b, 64)) * (a | 0x1234) - __bt(b, a & 7) + __cast(b, 64);
+
+    vtil::symbolic::compiled_expression program = x;
+    CHECK( program.variables.size() == 2 );
+
+    std::vector<uint64_t> values, results(100);
+    for (uint64_t i = 0; i != results.size(); i++)
+        for (auto& uid : program.variables)
+            values.push_back(uid.to_string() == "a" ? i * 0x9E3779B97F4A7C15 : ~i * 0x1337);
+    program.evaluate(values, results);
+
+    for (size_t i = 0; i != results.size(); i++)
+    {
+        std::span<const uint64_t> assignment = { &values[i * program.variables.size()], program.variables.size() };
+        auto lookup = [&](const vtil::symbolic::unique_identifier& uid) -> std::optional<uint64_t>
+        {
+            for (size_t n = 0; n != program.variables.size(); n++)
+                if (program.variables[n] == uid) return assignment[n];
+            return std::nullopt;
+        };
+        CHECK( program.evaluate(assignment) == results[i] );
+        CHECK( x->evaluate(lookup).known_one() == results[i] );
+    }
+}
+
+DOCTEST_TEST_CASE("Deep expression matching")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+    auto var = [](const std::string& name) { return expression::reference{ expression{ vtil::symbolic::unique_identifier{ name }, 64 } }; };
+    expression::reference x = var("x");
+    expression::reference y = var("y");
+
+    // Chain of 400 additions, as produced by stack arithmetic.
+    //
+    expression::reference chain = var("v0");
+    for (int i = 1; i != 400; i++)
+        chain = expression::make(chain, operator_id::add, var("v" + std::to_string(i)));
+    CHECK( chain->depth == 399 );
+
+    // Identical subtrees map every variable to itself.
+    //
+    auto tbl = expression::make(x, operator_id::subtract, chain).match_to(expression::make(y, operator_id::subtract, chain), true);
+    REQUIRE( tbl.has_value() );
+    CHECK( tbl->size() == 401 );
+
+    // Fails if an identical subtree uses a variable already mapped elsewhere.
+    //
+    expression::reference xchain = expression::make(chain, operator_id::bitwise_xor, x);
+    CHECK( !expression::make(x, operator_id::subtract, xchain).match_to(expression::make(y, operator_id::subtract, xchain), true) );
+
+    // Substituting constants into the chain still folds it completely.
+    //
+    auto folded = chain.transform([](vtil::symbolic::expression_delegate& exp)
+    {
+        if (exp->is_variable())
+            exp = expression{ std::stoull(exp->uid.to_string().substr(1)), 64 };
+    }, true);
+    CHECK( folded->get<uint64_t>() == 399 * 400 / 2 );
+}
+
+DOCTEST_TEST_CASE("Simplifier budget")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    vtil::symbolic::purge_simplifier_state();
+    vtil::symbolic::purge_shared_simplifier_cache();
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+    expression::reference a = expression{ vtil::symbolic::unique_identifier{ "a" }, 64 };
+    expression::reference b = expression{ vtil::symbolic::unique_identifier{ "b" }, 64 };
+    expression::reference x = expression::make(expression::make(a, operator_id::add, b), operator_id::subtract, b);
+
+    // Exhausted budget leaves the expression marked as simplified without touching the input.
+    //
+    expression::reference partial = x;
+    vtil::symbolic::simplify_expression(partial, vtil::symbolic::simplifier_budget{ .attempt_limit = 1 });
+    CHECK( vtil::symbolic::is_simplifier_budget_exhausted() );
+    CHECK( partial->simplify_hint );
+    CHECK( !x->simplify_hint );
+    CHECK( partial->equals(*x) );
+
+    // Incomplete results are not reused once the budget is available again.
+    //
+    expression::reference full = x;
+    vtil::symbolic::simplify_expression(full);
+    CHECK( !vtil::symbolic::is_simplifier_budget_exhausted() );
+    CHECK( full->is_identical(*a) );
+
+    // Workers of a split simplification share a single budget, each can only overshoot it
+    // by the attempt that exhausted it.
+    //
+    for (size_t workers : { 1, 4 })
+    {
+        vtil::symbolic::purge_simplifier_state();
+        vtil::symbolic::purge_shared_simplifier_cache();
+        size_t prev = vtil::symbolic::set_simplifier_worker_count(workers);
+        expression::reference y = make_wide_xor_tree();
+        vtil::symbolic::simplify_expression(y, vtil::symbolic::simplifier_budget{ .attempt_limit = 64, .time_limit = {} });
+        vtil::symbolic::set_simplifier_worker_count(prev);
+        CHECK( vtil::symbolic::is_simplifier_budget_exhausted() );
+        CHECK( vtil::symbolic::get_simplifier_attempt_count() > 64 );
+        CHECK( vtil::symbolic::get_simplifier_attempt_count() <= 64 + workers );
+    }
+}
+
+DOCTEST_TEST_CASE("Simplifier statistics")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+
+    // Shared cache statistics are reported even if the counters are not collected.
+    //
+    auto stats = vtil::symbolic::get_simplifier_statistics();
+    CHECK( stats.shared_cache.size == vtil::symbolic::get_shared_simplifier_cache_statistics().size );
+#if !VTIL_SYMEX_SIMPLIFY_STATISTICS
+    CHECK( stats.cache_hits == 0 );
+    CHECK( stats.directives.empty() );
+#endif
+
+    // JSON output lists the counters and the directives in order with the sources escaped.
+    //
+    vtil::symbolic::simplifier_statistics manual = {};
+    manual.cache_hits = 3;
+    manual.budget_bailouts = 7;
+    manual.shared_cache.size = 5;
+    manual.directives.push_back({ .table = "t", .index = 1, .source = "a\"b", .target = "c\\d", .attempts = 4, .successes = 2, .time_ns = 9 });
+    manual.directives.push_back({ .table = "u", .index = 2, .source = "x", .target = "y", .attempts = 1, .successes = 0, .time_ns = 0 });
+    std::string json = manual.to_json();
+    CHECK( json.starts_with("{\n  \"cache\": { \"hits\": 3, \"misses\": 0,") );
+    CHECK( json.find("\"shared_cache\": { \"size\": 5,") != std::string::npos );
+    CHECK( json.find("\"budget_bailouts\": 7,\n") != std::string::npos );
+    CHECK( json.find("{ \"table\": \"t\", \"index\": 1, \"source\": \"a\\\"b\", \"target\": \"c\\\\d\", \"attempts\": 4, \"successes\": 2, \"time_ns\": 9 },\n") != std::string::npos );
+    CHECK( json.find("\"table\": \"t\"") < json.find("\"table\": \"u\"") );
+    CHECK( json.ends_with("\"time_ns\": 0 }\n  ]\n}") );
+    CHECK( vtil::symbolic::simplifier_statistics{}.to_json().ends_with("\"directives\": []\n}") );
+}
+
+DOCTEST_TEST_CASE("Simplifier signature matching")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    vtil::symbolic::purge_simplifier_state();
+    vtil::symbolic::purge_shared_simplifier_cache();
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+    auto var = [](const std::string& name) { return expression::reference{ expression{ vtil::symbolic::unique_identifier{ name }, 64 } }; };
+    auto mix = [](const expression::reference& a, const expression::reference& b, const expression::reference& c) -> expression::reference
+    {
+        expression::reference s = expression::make(expression::make(a, operator_id::bitwise_or, b), operator_id::subtract, expression::make(a, operator_id::bitwise_and, b));
+        return expression::make(s, operator_id::bitwise_xor, c);
+    };
+    auto handler = [&](const expression::reference& a, const expression::reference& b, const expression::reference& c)
+    {
+        expression::reference k = expression::make(a, operator_id::bitwise_xor, expression{ 0x1337, 64 });
+        return expression::make(expression::make(mix(a, b, c), operator_id::add, k), operator_id::subtract, k);
+    };
+
+    // Simplifying an isomorphic expression reuses the cached result with the variables renamed.
+    //
+    expression::reference x = handler(var("a"), var("b"), var("c"));
+    expression::reference y = handler(var("d"), var("e"), var("f"));
+    REQUIRE( x->depth > 3 );
+    [[maybe_unused]] auto before = vtil::symbolic::get_simplifier_statistics().cache_signature_hits;
+    x.simplify();
+    y.simplify();
+    CHECK( x->is_identical(*mix(var("a"), var("b"), var("c"))) );
+    CHECK( y->is_identical(*mix(var("d"), var("e"), var("f"))) );
+#if VTIL_SYMEX_SIMPLIFY_STATISTICS
+    CHECK( vtil::symbolic::get_simplifier_statistics().cache_signature_hits > before );
+#endif
+    vtil::symbolic::purge_simplifier_state();
+}
+
+DOCTEST_TEST_CASE("Simplifier cache serialization")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    auto block = vtil::basic_block::begin(0x1337);
+    block->push(vtil::REG_SP)->vexit(0ull);
+
+    vtil::symbolic::purge_shared_simplifier_cache();
+    vtil::symbolic::expression::reference a = vtil::symbolic::variable{ block->begin(), vtil::REG_SP }.to_expression();
+    vtil::symbolic::expression::reference b = vtil::symbolic::variable{ block->end(), { vtil::symbolic::pointer{ a + 8 }, 64 } }.to_expression();
+    vtil::symbolic::expression::reference c = vtil::symbolic::expression{ vtil::symbolic::unique_identifier{ "c" }, 64 };
+    vtil::symbolic::expression::reference x = ((a + 4) + (b ^ c)) + 4;
+    x.simplify();
+
+    std::stringstream ss;
+    size_t saved = vtil::save_simplifier_cache(ss, block->owner);
+    CHECK( saved != 0 );
+
+    vtil::symbolic::purge_shared_simplifier_cache();
+    CHECK( vtil::load_simplifier_cache(ss, block->owner) == saved );
+    CHECK( vtil::symbolic::get_shared_simplifier_cache_statistics().size == saved );
+    vtil::symbolic::purge_shared_simplifier_cache();
+}
+
+DOCTEST_TEST_CASE("Expression graph serialization")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+    auto block = vtil::basic_block::begin(0x1337);
+    block->push(vtil::REG_SP)->vexit(0ull);
+
+    expression::reference a = vtil::symbolic::variable{ block->begin(), vtil::REG_SP }.to_expression();
+    expression::reference b = vtil::symbolic::variable{ block->end(), { vtil::symbolic::pointer{ a + 8 }, 64 } }.to_expression();
+    expression::reference c = expression{ vtil::symbolic::unique_identifier{ "c" }, 64 };
+    expression::reference shared = expression::make(expression::make(a, operator_id::subtract, expression{ -1, 64 }), operator_id::multiply, expression::make(b, operator_id::bitwise_xor, c));
+    std::vector<expression::reference> exps = {
+        expression::make(shared, operator_id::add, shared),
+        expression::make(operator_id::bitwise_not, shared),
+        expression::make(shared, operator_id::ucast, expression{ 32, 8 }),
+        b,
+    };
+
+    // Shared subtrees are written once.
+    //
+    std::stringstream ss, separate;
+    {
+        vtil::expression_dag_writer writer{ ss }, unshared{ separate };
+        for (auto& exp : exps)
+        {
+            writer.write(exp);
+            unshared.write(exp);
+            unshared.reset();
+        }
+        CHECK( ss.str().size() * 3 < separate.str().size() * 2 );
+        writer.reset();
+        writer.write(exps[0]);
+    }
+
+    // Graph is read back as is, sharing the nodes.
+    //
+    vtil::expression_dag_reader reader{ ss, block->owner };
+    std::vector<expression::reference> out;
+    for (expression::reference exp; reader.read(exp);)
+        out.emplace_back(std::move(exp));
+    REQUIRE( out.size() == exps.size() + 1 );
+    for (size_t i = 0; i != exps.size(); i++)
+        CHECK( out[i]->is_identical(*exps[i]) );
+    CHECK( out.back()->is_identical(*exps[0]) );
+    CHECK( out[0]->lhs.get() == out[0]->rhs.get() );
+    CHECK( out[1]->rhs.get() == out[0]->lhs.get() );
+
+    // Variables bound to blocks cannot be resolved without the routine.
+    //
+    ss.clear();
+    ss.seekg(0);
+    vtil::expression_dag_reader unbound{ ss };
+    expression::reference exp;
+    CHECK_THROWS( unbound.read(exp) );
+
+    // Identifiers that cannot be serialized are rejected before anything is written.
+    //
+    std::stringstream partial;
+    vtil::expression_dag_writer writer{ partial };
+    writer.write(c);
+    size_t size = partial.str().size();
+    CHECK_THROWS( writer.write(expression::make(c, operator_id::add, expression{ vtil::symbolic::unique_identifier{ 5 }, 64 })) );
+    CHECK( partial.str().size() == size );
+    writer.write(c);
+
+    vtil::expression_dag_reader intact{ partial };
+    for (int i = 0; i != 2; i++)
+    {
+        REQUIRE( intact.read(exp) );
+        CHECK( exp->is_identical(*c) );
+    }
+    CHECK( !intact.read(exp) );
+}
+
+DOCTEST_TEST_CASE("Cached tracer shards")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    auto block = vtil::basic_block::begin(0x1337);
+    auto t0 = block->tmp(64);
+    auto t1 = block->tmp(64);
+    block->bxor(t0, 0x1234ull)->add(t1, t0)->mov(t0, t1)->vexit(0ull);
+
+    vtil::tracer tracer = {};
+    vtil::cached_tracer ctracer = {};
+    for (auto it = std::next(block->begin()); !it.is_end(); ++it)
+        for (auto& reg : { t0, t1 })
+            CHECK( ctracer.trace({ it, reg })->is_identical(*tracer.trace({ it, reg })) );
+    CHECK( ctracer.size() == 6 );
+
+    // Copies index their own entries and flushing a block drops its shard.
+    //
+    vtil::cached_tracer copy = ctracer;
+    ctracer.flush(block);
+    CHECK( ctracer.size() == 0 );
+    REQUIRE( copy.shards.size() == 1 );
+    for (auto& [blk, shard] : copy.shards)
+    {
+        CHECK( shard->index.size() == shard->cache.size() );
+        for (auto& [key, entry] : shard->index)
+            CHECK( &*shard->cache.find(entry->first) == entry );
+    }
+
+    // Modifying the block invalidates its entries.
+    //
+    vtil::symbolic::variable var = { std::prev(block->end()), t0 };
+    auto before = copy.trace(var);
+    (+block->begin())->operands[1].imm().uval = 0x4321;
+    auto after = copy.trace(var);
+    CHECK( !before->is_identical(*after) );
+    CHECK( after->is_identical(*tracer.trace(var)) );
+    CHECK( copy.get_shard(block)->epoch == block->epoch );
+
+    // Revalidation carries the entries over a modification only if they were valid right before it.
+    //
+    vtil::epoch_t epoch = block->epoch;
+    +block->begin();
+    copy.revalidate(block, epoch);
+    CHECK( copy.shards.at(block)->epoch == block->epoch );
+
+    (+block->begin())->operands[1].imm().uval = 0x5678;
+    epoch = block->epoch;
+    +block->begin();
+    copy.revalidate(block, epoch);
+    CHECK( copy.shards.at(block)->epoch != block->epoch );
+    CHECK( copy.trace(var)->is_identical(*tracer.trace(var)) );
+}
+
+DOCTEST_TEST_CASE("Routine tracer")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    vtil::register_desc reg_eax( vtil::register_physical, registers::ax, vtil::arch::bit_count, 0 );
+
+    auto block1 = vtil::basic_block::begin(0x1337);
+    auto t0 = block1->tmp(64);
+    block1->mov(t0, 0x1234ull)->add(t0, 1ull)->jmp((uintptr_t) 0x2000);
+    auto block2 = block1->fork(0x2000);
+    block2->mov(reg_eax, 0x10ull)->add(reg_eax, 1ull)->vexit(0ull);
+    vtil::routine* rtn = block1->owner;
+
+    // The tracer is shared through the context of the routine.
+    //
+    vtil::routine_tracer& ctracer = rtn->context;
+    CHECK( &rtn->context.get<vtil::routine_tracer>() == &ctracer );
+    CHECK( *ctracer.trace({ std::prev(block1->end()), t0 })->get<uint64_t>() == 0x1235 );
+    CHECK( *ctracer.trace({ std::prev(block2->end()), reg_eax })->get<uint64_t>() == 0x11 );
+    auto shard1 = ctracer.get_shard(block1);
+    auto shard2 = ctracer.get_shard(block2);
+
+    // Clones do not inherit the entries.
+    //
+    vtil::routine* copy = rtn->clone();
+    CHECK( copy->context.get<vtil::routine_tracer>().size() == 0 );
+    delete copy;
+
+    // Entries of the blocks left untouched by a pass are kept.
+    //
+    vtil::optimizer::dead_code_elimination_pass{}(rtn);
+    CHECK( block1->size() == 1 );
+    CHECK( block2->size() == 3 );
+    CHECK( ctracer.get_shard(block1) != shard1 );
+    CHECK( ctracer.get_shard(block2) == shard2 );
+
+    // Entries of the blocks removed from the routine are pruned.
+    //
+    block1->next.clear();
+    block2->prev.clear();
+    rtn->delete_block(block2);
+    vtil::routine_tracer& ctracer2 = rtn->context;
+    CHECK( &ctracer2 == &ctracer );
+    CHECK( ctracer.shards.size() == 1 );
+}
+
+DOCTEST_TEST_CASE("Memoized cross-block tracing")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    vtil::register_desc reg_eax( vtil::register_physical, registers::ax, vtil::arch::bit_count, 0 );
+    vtil::register_desc reg_cc( vtil::register_physical, registers::cx, 1, 0 );
+
+    // Chain of diamonds, doubling the number of paths each.
+    //
+    auto block = vtil::basic_block::begin(0x1000);
+    vtil::routine* rtn = block->owner;
+    block->add(reg_eax, 1ull);
+    for (vtil::vip_t i = 1; i <= 24; i++)
+    {
+        block->js(reg_cc, i * 0x1000 + 1, i * 0x1000 + 2);
+        for (vtil::vip_t j = 1; j <= 2; j++)
+        {
+            auto [side, _] = rtn->create_block(i * 0x1000 + j, block);
+            side->add(reg_eax, 2ull)->jmp((i + 1) * 0x1000);
+            rtn->create_block((i + 1) * 0x1000, side);
+        }
+        block = rtn->get_block((i + 1) * 0x1000);
+        block->add(reg_eax, 1ull);
+    }
+    block->vexit(0ull);
+
+    vtil::symbolic::variable var = { std::prev(block->end()), reg_eax };
+    auto base = vtil::tracer{}.trace_p({ rtn->entry_point->begin(), reg_eax });
+    auto exp = vtil::tracer{}.rtrace_p(var);
+    CHECK( *(exp - base).get<int64_t>() == 24 * 3 + 1 );
+
+    // The routine tracer keeps the results until the routine is modified.
+    //
+    vtil::routine_tracer& rtracer = rtn->context;
+    CHECK( rtracer.rtrace_p(var)->equals(*exp) );
+    CHECK( !rtracer.memo.entries.empty() );
+    CHECK( rtracer.rtrace_p(var)->equals(*exp) );
+
+    (+rtn->entry_point->begin())->operands[1].imm().uval = 2;
+    CHECK( *(rtracer.rtrace_p(var) - base).get<int64_t>() == 24 * 3 + 2 );
+}
+
+DOCTEST_TEST_CASE("Indexed symbolic memory")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    auto block = vtil::basic_block::begin(0x1337);
+    block->vexit(0ull);
+
+    vtil::symbolic::expression::reference sp = vtil::symbolic::variable{ block->begin(), vtil::REG_SP }.to_expression();
+    vtil::symbolic::expression::reference bx = vtil::symbolic::variable{ block->begin(), { vtil::register_physical, registers::bx, 64, 0 } }.to_expression();
+
+    // Compare the indexed lookups against the linear search over a mix of overlapping
+    // stack accesses and accesses that may alias them.
+    //
+    for (bool relaxed : { false, true })
+    {
+        vtil::symbolic::memory indexed{ relaxed }, linear{ relaxed };
+        auto linear_distance = vtil::symbolic::memory::bit_distance;
+
+        uint64_t seed = 0x1234;
+        auto next = [&](uint64_t n) { seed = seed * 6364136223846793005ull + 1442695040888963407ull; return (seed >> 33) % n; };
+
+        for (uint64_t i = 0; i < 2000; i++)
+        {
+            bitcnt_t size = 8 << next(4);
+            vtil::symbolic::pointer ptr = next(64) ? vtil::symbolic::pointer{ sp + (int64_t(next(512)) - 256) } : vtil::symbolic::pointer{ bx + int64_t(next(8)) };
+
+            if (next(2))
+            {
+                vtil::symbolic::expression value = { i, size };
+                auto r1 = indexed.write(ptr, value);
+                auto r2 = linear.write(ptr, value, linear_distance);
+                CHECK(r1.has_value() == r2.has_value());
+            }
+            else
+            {
+                uint64_t c1 = 0, c2 = 0;
+                auto r1 = indexed.read(ptr, size, vtil::symbolic::free_form_iterator, &c1);
+                auto r2 = linear.read(ptr, size, vtil::symbolic::free_form_iterator, &c2, linear_distance);
+                CHECK(r1.is_valid() == r2.is_valid());
+                if (r1 && r2)
+                {
+                    CHECK(r1->equals(*r2));
+                    CHECK(c1 == c2);
+                }
+                CHECK(indexed.unknown_mask(ptr, size) == linear.unknown_mask(ptr, size, linear_distance));
+            }
+        }
+
+        CHECK(indexed.index_valid);
+        CHECK(indexed.value_map.size() == linear.value_map.size());
+        CHECK(std::equal(indexed.begin(), indexed.end(), linear.begin(), linear.end(), [](auto& a, auto& b)
+        {
+            return a.first == b.first && a.second->equals(*b.second);
+        }));
+    }
+}
+
+DOCTEST_TEST_CASE("Partial evaluation")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::math::bit_vector;
+    using vtil::math::operator_id;
+
+    // Known bits are propagated through carries and shifts by partially known amounts.
+    //
+    CHECK( vtil::math::evaluate_partial(operator_id::add, { 0, 0xF0, 8 }, { 1, 8 }).to_string() == "????0001" );
+    CHECK( vtil::math::evaluate_partial(operator_id::subtract, { 0x10, 0x0C, 8 }, { 1, 8 }).to_string() == "000???11" );
+    CHECK( vtil::math::evaluate_partial(operator_id::shift_left, { 0, 0xFF, 8 }, { 2, 1, 8 }).to_string() == "??????00" );
+    CHECK( vtil::math::evaluate_partial(operator_id::uless, { 0, 0x2, 8 }, { 3, 8 }).get() == 1 );
+
+    // Result must hold for every value the unknown bits can take, each operator is also timed on the same inputs.
+    // Division is skipped as immediate zero divisors log a warning.
+    //
+    std::vector<std::pair<bit_vector, bit_vector>> inputs;
+    for (uint64_t i = 0; i != 512; i++)
+    {
+        uint64_t v = i * 0x9E3779B97F4A7C15;
+        bitcnt_t n = 1 + (i % 5);
+        inputs.emplace_back(bit_vector{ v >> 8, (v >> 32) & ((v >> 48) | (i & 1 ? 0 : ~0ull)), n },
+                            bit_vector{ v >> 16, (v >> 40) & (v >> 56), n });
+    }
+    for (int id = int(operator_id::invalid) + 1; id != int(operator_id::max); id++)
+    {
+        auto op = operator_id(id);
+        auto& desc = vtil::math::descriptor_of(op);
+        if (op == operator_id::cast || op == operator_id::ucast || op == operator_id::divide || op == operator_id::udivide ||
+            op == operator_id::remainder || op == operator_id::uremainder)
+            continue;
+        auto lhs_of = [&](const bit_vector& lhs)
+        {
+            if (desc.operand_count == 1)       return bit_vector{};
+            if (op == operator_id::value_if)   return bit_vector{ lhs }.resize(1);
+            return lhs;
+        };
+
+        volatile uint64_t sink = 0;
+        auto time_0 = std::chrono::steady_clock::now();
+        for (int rep = 0; rep != 16; rep++)
+            for (auto& [lhs, rhs] : inputs)
+                sink = sink + vtil::math::evaluate_partial(op, lhs_of(lhs), rhs).unknown_mask();
+        auto time_1 = std::chrono::steady_clock::now();
+        vtil::logger::log("%-12s %6.2f ns\n", desc.function_name ? desc.function_name : desc.symbol,
+                          std::chrono::duration<double, std::nano>(time_1 - time_0).count() / (16 * inputs.size()));
+
+        for (auto& [lhs, rhs] : inputs)
+        {
+            bit_vector l = lhs_of(lhs);
+            bit_vector result = vtil::math::evaluate_partial(op, l, rhs);
+            for (uint64_t lu = 0; lu <= l.unknown_mask(); lu++)
+            {
+                if (lu & ~l.unknown_mask()) continue;
+                for (uint64_t ru = 0; ru <= rhs.unknown_mask(); ru++)
+                {
+                    if (ru & ~rhs.unknown_mask()) continue;
+                    auto [value, size] = vtil::math::evaluate(op, l.size(), l.known_one() | lu, rhs.size(), rhs.known_one() | ru);
+                    CHECK( size == result.size() );
+                    CHECK( (value & result.known_mask()) == result.known_one() );
+                }
+            }
+        }
+    }
+}
+
+DOCTEST_TEST_CASE("Hash quality")
+{
+    vtil::logger::log("\n\n>> %s \n", __FUNCTION__);
+    using vtil::symbolic::expression;
+    using vtil::math::operator_id;
+    expression::reference x = expression{ vtil::symbolic::unique_identifier{ "x" }, 64 };
+    expression::reference y = expression{ vtil::symbolic::unique_identifier{ "y" }, 64 };
+
+    // Structurally distinct expressions should neither collide nor cluster in the low bits used for bucketing.
+    //
+    std::unordered_set<uint64_t> hashes;
+    std::vector<uint32_t> buckets(1 << 12);
+    size_t count = 0;
+    for (auto op1 : { operator_id::add, operator_id::bitwise_xor, operator_id::multiply })
+        for (auto op2 : { operator_id::subtract, operator_id::bitwise_and, operator_id::shift_left })
+            for (uint64_t i = 0; i != 4096; i++, count++)
+            {
+                uint64_t h = expression::make(expression::make(x, op1, expression{ i, 64 }), op2, y).hash().as64();
+                hashes.insert(h);
+                buckets[h & 0xFFF]++;
+            }
+    CHECK( hashes.size() == count );
+    double expected = double(count) / buckets.size(), chi2 = 0;
+    for (uint32_t n : buckets)
+        chi2 += (n - expected) * (n - expected) / expected;
+    vtil::logger::log("chi2 per bucket: %.3f\n", chi2 / buckets.size());
+#if VTIL_USE_WYHASH
+    CHECK( chi2 / buckets.size() < 1.25 );
+#endif
+
+    // Throughput of hashing trivial byte ranges and combining.
+    //
+    struct range { uint64_t value[4]; };
+    volatile uint64_t sink = 0;
+    auto time_0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i != 1000000; i++)
+        sink = sink + vtil::make_hash(i, uint8_t(i), range{ i, ~i, i, ~i }).as64();
+    auto time_1 = std::chrono::steady_clock::now();
+    vtil::logger::log("make_hash: %.2f ns\n", std::chrono::duration<double, std::nano>(time_1 - time_0).count() / 1000000);
+}
+
 DOCTEST_TEST_CASE("Optimization vtil file")
 {
     vtil::logger::log("\n\n>> %s \n", __FUNCTION__);